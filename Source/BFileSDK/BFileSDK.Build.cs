@@ -8,10 +8,13 @@ public class BFileSDK : ModuleRules
     {
         PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
 
-        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "Json", "BZipLib", "BUtilities" });
+        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "RenderCore", "Json", "BZipLib", "BUtilities" });
 
         PrivateDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine" });
 
+        //zstd is not bundled with the engine; set to 1 and add a zstd module dependency to enable EBFileCompressionCodec_Zstd.
+        PublicDefinitions.Add("BFILESDK_WITH_ZSTD=0");
+
         if (Target.Type == TargetRules.TargetType.Editor)
         {
             PublicDependencyModuleNames.AddRange(new string[] { "UnrealEd" });
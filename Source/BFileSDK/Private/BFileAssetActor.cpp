@@ -103,7 +103,7 @@ ABFileAssetActor* UBFileAssetActorManager::SpawnXAsset(
 {
 	if (SerializedContent.Num() == 0) return nullptr;
 	if (!DeserializedContent.IsValid()) return nullptr;
-	if (!DeserializedContent->RootNode.IsValid()) return nullptr;
+	if (!DeserializedContent->HasRoot()) return nullptr;
 
 	auto Actor = SpawnActorInternal<ABFileAssetActor>(WorldContextObject->GetWorld(), ABFileAssetActor::StaticClass(), InitialTransform);
 	Actor->DeserializedContent = DeserializedContent;
@@ -115,18 +115,28 @@ ABFileAssetActor* UBFileAssetActorManager::SpawnXAsset(
 	}
 #endif
 
-	FThreadSafeCounter* ParallelTaskCounter = new FThreadSafeCounter(Actor->DeserializedContent->GeometryIDToNodeMap.Num());
+	const int32 GeometryCount = DeserializedContent->GeometryIDs.Num();
+
+	//By geometry index; the ID maps are kept for outside users.
+	TArray<UStaticMesh*> StaticMeshes;
+	StaticMeshes.SetNumUninitialized(GeometryCount);
+	TArray<UBSMCSwitcher*> MeshComponents;
+	MeshComponents.SetNumUninitialized(GeometryCount);
+
+	FThreadSafeCounter* ParallelTaskCounter = new FThreadSafeCounter(GeometryCount);
 	FEvent* ParallelTaskCounter_CompletedEvent = FGenericPlatformProcess::GetSynchEventFromPool();
 
-	for (auto& GPair : Actor->DeserializedContent->GeometryIDToNodeMap)
+	for (int32 GeometryIndex = 0; GeometryIndex < GeometryCount; GeometryIndex++)
 	{
-		int64 GUniqueID = GPair.Key;
-		auto GSerializedRenderDataPtr = &GPair.Value->SerializedRenderData;
+		int64 GUniqueID = DeserializedContent->GeometryIDs[GeometryIndex];
+		auto GSerializedRenderDataPtr = &DeserializedContent->GeometrySerializedRenderData[GeometryIndex];
 
 		UStaticMesh* StaticMesh = NewObject<UStaticMesh>(Actor);
 		Actor->GeometryID_StaticMesh_Map.Add(GUniqueID, StaticMesh);
+		StaticMeshes[GeometryIndex] = StaticMesh;
 
-		Actor->GeometryID_MeshComponent_Map.Add(GUniqueID, NewObject<UBSMCSwitcher>(Actor));
+		MeshComponents[GeometryIndex] = NewObject<UBSMCSwitcher>(Actor);
+		Actor->GeometryID_MeshComponent_Map.Add(GUniqueID, MeshComponents[GeometryIndex]);
 
 		FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([GUniqueID, GSerializedRenderDataPtr, StaticMesh, ParallelTaskCounter, ParallelTaskCounter_CompletedEvent]()
 			{
@@ -138,7 +148,10 @@ ABFileAssetActor* UBFileAssetActorManager::SpawnXAsset(
 			});
 	}
 
-	ParallelTaskCounter_CompletedEvent->Wait();
+	if (GeometryCount > 0)
+	{
+		ParallelTaskCounter_CompletedEvent->Wait();
+	}
 	FGenericPlatformProcess::ReturnSynchEventToPool(ParallelTaskCounter_CompletedEvent);
 
 	delete ParallelTaskCounter;
@@ -148,16 +161,16 @@ ABFileAssetActor* UBFileAssetActorManager::SpawnXAsset(
 		BFileMeshSerialization::DeserializeToStaticMesh_ExecutePostThreadablePart(GMPair.Value);
 	}
 
-	TMap<UBSMCSwitcher*, TWeakPtr<BFinalGeometryPart>> OneGPartOccurrenceMap;
+	TMap<UBSMCSwitcher*, int32> OneGPartOccurrenceMap;
 	TArray<UBFileAssetHISMComponent*> HISMCList;
-	Actor->InitializeRecursive(DeserializedContent->RootNode, OneGPartOccurrenceMap, HISMCList);
+	Actor->InitializeParts(StaticMeshes, MeshComponents, OneGPartOccurrenceMap, HISMCList);
 
 	//Get all SMC for the actor and setup
 	for (auto& SMCPair : OneGPartOccurrenceMap)
 	{
-		TSharedPtr<BFinalGeometryPart> GPart = SMCPair.Value.Pin();
+		const int32 Part = SMCPair.Value;
 
-		auto StaticMesh = Actor->GeometryID_StaticMesh_Map[GPart->GeometryNode.Pin()->UniqueID];
+		auto StaticMesh = StaticMeshes[DeserializedContent->PartGeometries[Part]];
 
 		SMCPair.Key->SMC = NewObject<UBFileAssetSMComponent>(Actor);
 		SMCPair.Key->SMC->SetStaticMesh(StaticMesh);
@@ -166,7 +179,7 @@ ABFileAssetActor* UBFileAssetActorManager::SpawnXAsset(
 		{
 			UMaterialInstanceDynamic* MeshMaterialDynamicInstance = UMaterialInstanceDynamic::Create(Actor->MeshMaterial_NonInstanced, Actor);
 			SMCPair.Key->SMC->SetMaterial(0, MeshMaterialDynamicInstance);
-			MeshMaterialDynamicInstance->SetScalarParameterValue("ColorCompressed", ABFileAssetActor::CompressColorAsSingleFloat(SMCPair.Value.Pin()->Color));
+			MeshMaterialDynamicInstance->SetScalarParameterValue("ColorCompressed", ABFileAssetActor::CompressColorAsSingleFloat(DeserializedContent->PartColors[Part]));
 		}
 		
 		Actor->AddOwnedComponent(SMCPair.Key->SMC);
@@ -189,24 +202,28 @@ ABFileAssetActor* UBFileAssetActorManager::SpawnXAsset(
 	return Actor;
 }
 
-void ABFileAssetActor::InitializeRecursive(
-	TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> Node, 
-	TMap<UBSMCSwitcher*, TWeakPtr<BFinalGeometryPart>>& OneGPartOccurrenceMap, 
+void ABFileAssetActor::InitializeParts(
+	const TArray<UStaticMesh*>& StaticMeshes,
+	const TArray<UBSMCSwitcher*>& MeshComponents,
+	TMap<UBSMCSwitcher*, int32>& OneGPartOccurrenceMap, 
 	TArray<UBFileAssetHISMComponent*>& HISMCList)
 {
-	auto Pinned = Node.Pin();
+	BFinalAssetContent& Content = *DeserializedContent;
 
-	for (TSharedPtr<BFinalGeometryPart> GPart : Pinned->Geometries)
+	//Parts are stored node by node; a linear pass visits all of them without walking the tree.
+	for (int32 Part = 0; Part < Content.PartGeometries.Num(); Part++)
 	{
-		int64 GUniqueID = GPart->GeometryNode.Pin()->UniqueID;
-		UBSMCSwitcher* GPartSMC = GeometryID_MeshComponent_Map[GUniqueID];
+		const int32 GeometryIndex = Content.PartGeometries[Part];
+		if (GeometryIndex == INDEX_NONE) continue;
+
+		UBSMCSwitcher* GPartSMC = MeshComponents[GeometryIndex];
 
 		GPartSMC->NumOccurrence++;
 
 		//Time for creating HISMC
 		if (GPartSMC->NumOccurrence == 2)
 		{
-			auto StaticMesh = GeometryID_StaticMesh_Map[GUniqueID];
+			auto StaticMesh = StaticMeshes[GeometryIndex];
 
 			GPartSMC->ComponentType = EBFileAssetRenderComponentType::HISMC;
 
@@ -228,34 +245,29 @@ void ABFileAssetActor::InitializeRecursive(
 			GPartSMC->HISMC->bHasPerInstanceHitProxies = true;
 			GPartSMC->HISMC->NumCustomDataFloats = 1;
 
-			TSharedPtr<BFinalGeometryPart> FirstGPart = OneGPartOccurrenceMap.FindAndRemoveChecked(GPartSMC).Pin();
+			const int32 FirstPart = OneGPartOccurrenceMap.FindAndRemoveChecked(GPartSMC);
 
-			FirstGPart->InstanceIndex = GPartSMC->HISMC->PerInstanceSMData.Add(FirstGPart->Transform.ToMatrixWithScale());
-			GPartSMC->HISMC->PerInstanceSMCustomData.Add(CompressColorAsSingleFloat(FirstGPart->Color));
+			Content.PartInstanceIndexes[FirstPart] = GPartSMC->HISMC->PerInstanceSMData.Add(Content.PartTransforms[FirstPart].ToMatrixWithScale());
+			GPartSMC->HISMC->PerInstanceSMCustomData.Add(CompressColorAsSingleFloat(Content.PartColors[FirstPart]));
 
-			GPart->InstanceIndex = GPartSMC->HISMC->PerInstanceSMData.Add(GPart->Transform.ToMatrixWithScale());
+			Content.PartInstanceIndexes[Part] = GPartSMC->HISMC->PerInstanceSMData.Add(Content.PartTransforms[Part].ToMatrixWithScale());
 
-			GPartSMC->HISMC->PerInstanceSMCustomData.Add(CompressColorAsSingleFloat(GPart->Color));
+			GPartSMC->HISMC->PerInstanceSMCustomData.Add(CompressColorAsSingleFloat(Content.PartColors[Part]));
 		}
 		//Add new instance to HISMC
 		else if (GPartSMC->NumOccurrence > 2)
 		{
-			GPart->InstanceIndex = GPartSMC->HISMC->PerInstanceSMData.Add(GPart->Transform.ToMatrixWithScale());
+			Content.PartInstanceIndexes[Part] = GPartSMC->HISMC->PerInstanceSMData.Add(Content.PartTransforms[Part].ToMatrixWithScale());
 
-			GPartSMC->HISMC->PerInstanceSMCustomData.Add(CompressColorAsSingleFloat(GPart->Color));
+			GPartSMC->HISMC->PerInstanceSMCustomData.Add(CompressColorAsSingleFloat(Content.PartColors[Part]));
 		}					
 		else // if (GPartSMC.NumOccurrence == 1) /*Only option left*/
 		{
 			GPartSMC->ComponentType = EBFileAssetRenderComponentType::SMC;
 
-			OneGPartOccurrenceMap.Add(GPartSMC, GPart);
+			OneGPartOccurrenceMap.Add(GPartSMC, Part);
 		}
 	}
-
-	for (int32 i = 0; i < Pinned->Children.Num(); i++)
-	{
-		InitializeRecursive(Pinned->Children[i], OneGPartOccurrenceMap, HISMCList);
-	}
 }
 
 float ABFileAssetActor::CompressColorAsSingleFloat(const FColor& Color, uint8 Reserved7Bit)
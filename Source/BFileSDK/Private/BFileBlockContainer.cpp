@@ -0,0 +1,283 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileBlockContainer.h"
+#include "BFileImportTelemetry.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/Compression.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/ThreadSafeBool.h"
+
+#define X_BLOCK_CONTAINER_HEADER_SIZE (sizeof(uint32) + sizeof(int32))
+#define X_BLOCK_CONTAINER_ENTRY_SIZE (sizeof(int64) + sizeof(int32) + sizeof(int32))
+#define X_BLOCK_CONTAINER_FOOTER_SIZE (sizeof(int64) + sizeof(int32) + sizeof(int64) + sizeof(uint32))
+
+BFileBlockContainerWriter::BFileBlockContainerWriter(TFunction<bool(const uint8*, int64)> InWrite, BFileImportTelemetry* InTelemetry)
+	: Write(InWrite)
+	, Telemetry(InTelemetry)
+{
+	SetIsSaving(true);
+
+	//Enough to keep every worker busy while the oldest block is being written.
+	MaxBlocksInFlight = 2 * (FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+
+	CurrentBlock.Reserve(X_BLOCK_CONTAINER_BLOCK_SIZE);
+
+	uint32 Magic = X_BLOCK_CONTAINER_MAGIC;
+	int32 BlockSize = X_BLOCK_CONTAINER_BLOCK_SIZE;
+	WriteRaw(&Magic, sizeof(Magic));
+	WriteRaw(&BlockSize, sizeof(BlockSize));
+}
+
+BFileBlockContainerWriter::~BFileBlockContainerWriter()
+{
+	//Compression tasks report to the telemetry; none may outlive the writer.
+	for (TFuture<TArray<uint8>>& Block : InFlightBlocks)
+	{
+		Block.Wait();
+	}
+}
+
+void BFileBlockContainerWriter::Serialize(void* Data, int64 Num)
+{
+	const uint8* Source = (const uint8*)Data;
+	while (Num > 0 && !IsError())
+	{
+		const int32 Copied = (int32)FMath::Min<int64>(Num, X_BLOCK_CONTAINER_BLOCK_SIZE - CurrentBlock.Num());
+		CurrentBlock.Append(Source, Copied);
+
+		Source += Copied;
+		Num -= Copied;
+		UncompressedSize += Copied;
+
+		if (CurrentBlock.Num() == X_BLOCK_CONTAINER_BLOCK_SIZE)
+		{
+			SubmitBlock();
+		}
+	}
+}
+
+bool BFileBlockContainerWriter::Finish()
+{
+	SubmitBlock();
+	while (InFlightBlocks.Num() > 0)
+	{
+		WriteOldestBlock();
+	}
+
+	int64 TableOffset = ContainerSize;
+	for (FBBlockContainerEntry& Entry : Entries)
+	{
+		WriteRaw(&Entry.CompressedOffset, sizeof(Entry.CompressedOffset));
+		WriteRaw(&Entry.CompressedSize, sizeof(Entry.CompressedSize));
+		WriteRaw(&Entry.UncompressedSize, sizeof(Entry.UncompressedSize));
+	}
+
+	int32 BlockCount = Entries.Num();
+	uint32 Magic = X_BLOCK_CONTAINER_MAGIC;
+	WriteRaw(&TableOffset, sizeof(TableOffset));
+	WriteRaw(&BlockCount, sizeof(BlockCount));
+	WriteRaw(&UncompressedSize, sizeof(UncompressedSize));
+	WriteRaw(&Magic, sizeof(Magic));
+
+	return !IsError();
+}
+
+void BFileBlockContainerWriter::SubmitBlock()
+{
+	if (CurrentBlock.Num() == 0) return;
+
+	BFileImportTelemetry* TelemetryPtr = Telemetry;
+
+	InFlightBlockSizes.Add(CurrentBlock.Num());
+	InFlightBlocks.Add(Async(EAsyncExecution::ThreadPool, [Block = MoveTemp(CurrentBlock), TelemetryPtr]()
+		{
+			BFileImportTelemetry::FBScope CompressScope(TelemetryPtr, EBImportTimer_BlockCompression);
+
+			int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, Block.Num());
+			TArray<uint8> Compressed;
+			Compressed.SetNumUninitialized(CompressedSize);
+
+			if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Block.GetData(), Block.Num(), COMPRESS_BiasMemory))
+			{
+				Compressed.Empty();
+				return Compressed;
+			}
+			Compressed.SetNum(CompressedSize, false);
+			return Compressed;
+		}));
+
+	CurrentBlock.Reset(X_BLOCK_CONTAINER_BLOCK_SIZE);
+
+	//Blocks complete out of order but are written in order; the oldest is waited for only when too many are in flight.
+	while (InFlightBlocks.Num() > 0 && (InFlightBlocks.Num() >= MaxBlocksInFlight || InFlightBlocks[0].IsReady()))
+	{
+		WriteOldestBlock();
+	}
+}
+
+void BFileBlockContainerWriter::WriteOldestBlock()
+{
+	const TArray<uint8>& Compressed = InFlightBlocks[0].Get();
+	if (Compressed.Num() == 0)
+	{
+		SetError();
+	}
+	else if (!IsError())
+	{
+		Entries.Add({ ContainerSize, Compressed.Num(), InFlightBlockSizes[0] });
+		WriteRaw(Compressed.GetData(), Compressed.Num());
+	}
+
+	InFlightBlocks.RemoveAt(0, 1, false);
+	InFlightBlockSizes.RemoveAt(0, 1, false);
+}
+
+void BFileBlockContainerWriter::WriteRaw(const void* Data, int64 Num)
+{
+	if (IsError()) return;
+
+	if (!Write((const uint8*)Data, Num))
+	{
+		SetError();
+		return;
+	}
+	ContainerSize += Num;
+}
+
+BFileBlockContainerReader::BFileBlockContainerReader(const TArray<uint8>& InContainer)
+	: Container(InContainer)
+{
+	SetIsLoading(true);
+
+	//Task graph workers plus the calling thread; ParallelFor runs on both, so this never waits on a pool it is running on.
+	WindowCapacity = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+
+	if (!ReadTable())
+	{
+		Entries.Empty();
+		UncompressedSize = 0;
+		SetError();
+	}
+}
+
+bool BFileBlockContainerReader::IsBlockContainer(const TArray<uint8>& InBytes)
+{
+	//Single-stream files start with the FArchiveSaveCompressedProxy chunk tag, which never matches the magic.
+	uint32 Magic = 0;
+	if (InBytes.Num() >= (int32)sizeof(Magic))
+	{
+		FMemory::Memcpy(&Magic, InBytes.GetData(), sizeof(Magic));
+	}
+	return Magic == X_BLOCK_CONTAINER_MAGIC;
+}
+
+bool BFileBlockContainerReader::ReadTable()
+{
+	if (Container.Num() < (int32)(X_BLOCK_CONTAINER_HEADER_SIZE + X_BLOCK_CONTAINER_FOOTER_SIZE)) return false;
+
+	FMemoryReader Reader(Container);
+
+	uint32 Magic;
+	int32 BlockSize;
+	Reader << Magic;
+	Reader << BlockSize;
+	if (Magic != X_BLOCK_CONTAINER_MAGIC || BlockSize <= 0) return false;
+
+	Reader.Seek(Container.Num() - X_BLOCK_CONTAINER_FOOTER_SIZE);
+	int64 TableOffset;
+	int32 BlockCount;
+	Reader << TableOffset;
+	Reader << BlockCount;
+	Reader << UncompressedSize;
+	Reader << Magic;
+	if (Magic != X_BLOCK_CONTAINER_MAGIC || BlockCount < 0 || UncompressedSize < 0
+		|| TableOffset < (int64)X_BLOCK_CONTAINER_HEADER_SIZE
+		|| TableOffset + BlockCount * (int64)X_BLOCK_CONTAINER_ENTRY_SIZE != Container.Num() - (int64)X_BLOCK_CONTAINER_FOOTER_SIZE) return false;
+
+	//Blocks must be contiguous and add up to both sizes before any of them is touched.
+	Reader.Seek(TableOffset);
+	Entries.SetNumUninitialized(BlockCount);
+
+	int64 ExpectedOffset = X_BLOCK_CONTAINER_HEADER_SIZE;
+	int64 UncompressedSum = 0;
+	for (FBBlockContainerEntry& Entry : Entries)
+	{
+		Reader << Entry.CompressedOffset;
+		Reader << Entry.CompressedSize;
+		Reader << Entry.UncompressedSize;
+
+		if (Entry.CompressedOffset != ExpectedOffset || Entry.CompressedSize <= 0
+			|| Entry.UncompressedSize <= 0 || Entry.UncompressedSize > BlockSize) return false;
+
+		ExpectedOffset += Entry.CompressedSize;
+		UncompressedSum += Entry.UncompressedSize;
+	}
+	return !Reader.IsError() && ExpectedOffset == TableOffset && UncompressedSum == UncompressedSize;
+}
+
+void BFileBlockContainerReader::Serialize(void* Data, int64 Num)
+{
+	uint8* Destination = (uint8*)Data;
+	while (Num > 0 && !IsError())
+	{
+		if (CurrentBlock >= Entries.Num())
+		{
+			SetError();
+			break;
+		}
+		if (CurrentBlock >= WindowFirstBlock + Window.Num())
+		{
+			InflateWindow(CurrentBlock);
+			continue;
+		}
+
+		const TArray<uint8>& Block = Window[CurrentBlock - WindowFirstBlock];
+		const int32 Copied = (int32)FMath::Min<int64>(Num, Block.Num() - OffsetInBlock);
+		FMemory::Memcpy(Destination, Block.GetData() + OffsetInBlock, Copied);
+
+		Destination += Copied;
+		Num -= Copied;
+		Position += Copied;
+		OffsetInBlock += Copied;
+
+		if (OffsetInBlock == Block.Num())
+		{
+			CurrentBlock++;
+			OffsetInBlock = 0;
+		}
+	}
+
+	if (Num > 0)
+	{
+		FMemory::Memzero(Destination, Num);
+	}
+}
+
+void BFileBlockContainerReader::InflateWindow(int32 InFirstBlock)
+{
+	const int32 BlockCount = FMath::Min(WindowCapacity, Entries.Num() - InFirstBlock);
+
+	//Buffers of the previous window are reused.
+	Window.SetNum(BlockCount);
+	WindowFirstBlock = InFirstBlock;
+
+	FThreadSafeBool bFailed = false;
+	ParallelFor(BlockCount, [this, &bFailed](int32 i)
+		{
+			const FBBlockContainerEntry& Entry = Entries[WindowFirstBlock + i];
+			TArray<uint8>& Block = Window[i];
+			Block.SetNumUninitialized(Entry.UncompressedSize, false);
+
+			if (!FCompression::UncompressMemory(NAME_Zlib, Block.GetData(), Entry.UncompressedSize, Container.GetData() + Entry.CompressedOffset, Entry.CompressedSize))
+			{
+				bFailed = true;
+			}
+		});
+
+	if (bFailed)
+	{
+		SetError();
+	}
+}
\ No newline at end of file
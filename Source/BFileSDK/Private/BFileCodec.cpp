@@ -0,0 +1,233 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileCodec.h"
+#include "BInflateDeflate.h"
+#include "Misc/Compression.h"
+
+#if BFILESDK_WITH_ZSTD
+#include "zstd.h"
+#endif
+
+#define X_LZ4_MAX_BLOCK_SIZE (64 * 1024 * 1024)
+#define X_ZSTD_COMPRESSION_LEVEL 3
+
+bool BFileCodec::IsAvailable(EBFileCompressionCodec Codec)
+{
+	switch (Codec)
+	{
+	case EBFileCompressionCodec_Deflate:
+	case EBFileCompressionCodec_LZ4:
+		return true;
+	case EBFileCompressionCodec_Zstd:
+		return BFILESDK_WITH_ZSTD != 0;
+	default:
+		return false;
+	}
+}
+
+const TCHAR* BFileCodec::GetName(EBFileCompressionCodec Codec)
+{
+	switch (Codec)
+	{
+	case EBFileCompressionCodec_Deflate: return TEXT("deflate");
+	case EBFileCompressionCodec_LZ4: return TEXT("lz4");
+	case EBFileCompressionCodec_Zstd: return TEXT("zstd");
+	default: return TEXT("unknown");
+	}
+}
+
+bool BFileCodec::FromName(const FString& Name, EBFileCompressionCodec& OutCodec)
+{
+	for (uint8 Codec = EBFileCompressionCodec_Deflate; Codec <= EBFileCompressionCodec_Zstd; Codec++)
+	{
+		if (Name.Equals(GetName((EBFileCompressionCodec)Codec), ESearchCase::IgnoreCase))
+		{
+			OutCodec = (EBFileCompressionCodec)Codec;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool BFileCodec::Decompress(
+	EBFileCompressionCodec Codec,
+	std::istream* InStream,
+	TFunction<void(uint8*, int32)> OnChunkDecompressed,
+	TFunction<void(const FString&)> OnError)
+{
+	if (!IsAvailable(Codec))
+	{
+		OnError(FString::Printf(TEXT("Compression codec %s (%u) is not available in this build."), GetName(Codec), (uint32)Codec));
+		return false;
+	}
+
+	switch (Codec)
+	{
+	case EBFileCompressionCodec_LZ4:
+		return Decompress_LZ4(InStream, OnChunkDecompressed, OnError);
+	case EBFileCompressionCodec_Zstd:
+		return Decompress_Zstd(InStream, OnChunkDecompressed, OnError);
+	default:
+		BInflateDeflate::DecompressBytes(InStream, OnChunkDecompressed, OnError);
+		return true;
+	}
+}
+
+bool BFileCodec::Compress(
+	EBFileCompressionCodec Codec,
+	const uint8* InBytes,
+	int64 InSize,
+	TArray<uint8>& OutBytes)
+{
+	if (!IsAvailable(Codec)) return false;
+
+	OutBytes.Reset();
+
+	//Deflate streams are compressed as a whole, header included, so that they stay readable by older readers.
+	if (Codec == EBFileCompressionCodec_Deflate) return Compress_Deflate(InBytes, InSize, OutBytes);
+
+	if (!BFileHeader::WriteCompressedStreamHeader(Codec, InBytes, InSize, OutBytes)) return false;
+	const int32 HeaderSize = OutBytes.Num();
+
+	switch (Codec)
+	{
+	case EBFileCompressionCodec_LZ4:
+		return Compress_LZ4(InBytes + HeaderSize, InSize - HeaderSize, OutBytes);
+	default:
+		return Compress_Zstd(InBytes + HeaderSize, InSize - HeaderSize, OutBytes);
+	}
+}
+
+bool BFileCodec::Decompress_LZ4(std::istream* InStream, TFunction<void(uint8*, int32)> OnChunkDecompressed, TFunction<void(const FString&)> OnError)
+{
+	TArray<uint8> CompressedBlock;
+	TArray<uint8> UncompressedBlock;
+
+	while (true)
+	{
+		int32 BlockSizes[2]; //Uncompressed, compressed
+		std::streamsize Read = InStream->read((char*)BlockSizes, sizeof(BlockSizes)).gcount();
+		if (Read == 0) return true;
+
+		if (Read != sizeof(BlockSizes)
+			|| BlockSizes[0] <= 0 || BlockSizes[0] > X_LZ4_MAX_BLOCK_SIZE
+			|| BlockSizes[1] <= 0 || BlockSizes[1] > X_LZ4_MAX_BLOCK_SIZE)
+		{
+			OnError(TEXT("LZ4: Invalid block header."));
+			return false;
+		}
+
+		CompressedBlock.SetNumUninitialized(BlockSizes[1], false);
+		if (InStream->read((char*)CompressedBlock.GetData(), BlockSizes[1]).gcount() != BlockSizes[1])
+		{
+			OnError(TEXT("LZ4: Truncated block."));
+			return false;
+		}
+
+		UncompressedBlock.SetNumUninitialized(BlockSizes[0], false);
+		if (!FCompression::UncompressMemory(NAME_LZ4, UncompressedBlock.GetData(), BlockSizes[0], CompressedBlock.GetData(), BlockSizes[1]))
+		{
+			OnError(TEXT("LZ4: Block could not be decompressed."));
+			return false;
+		}
+
+		OnChunkDecompressed(UncompressedBlock.GetData(), BlockSizes[0]);
+	}
+}
+
+bool BFileCodec::Decompress_Zstd(std::istream* InStream, TFunction<void(uint8*, int32)> OnChunkDecompressed, TFunction<void(const FString&)> OnError)
+{
+#if BFILESDK_WITH_ZSTD
+	ZSTD_DStream* DecompressionStream = ZSTD_createDStream();
+	ZSTD_initDStream(DecompressionStream);
+
+	TArray<uint8> In;
+	In.SetNumUninitialized(ZSTD_DStreamInSize());
+	TArray<uint8> Out;
+	Out.SetNumUninitialized(ZSTD_DStreamOutSize());
+
+	bool bSucceed = true;
+
+	std::streamsize Read;
+	while (bSucceed && (Read = InStream->read((char*)In.GetData(), In.Num()).gcount()) > 0)
+	{
+		ZSTD_inBuffer Input = { In.GetData(), (size_t)Read, 0 };
+		while (Input.pos < Input.size)
+		{
+			ZSTD_outBuffer Output = { Out.GetData(), (size_t)Out.Num(), 0 };
+
+			size_t Result = ZSTD_decompressStream(DecompressionStream, &Output, &Input);
+			if (ZSTD_isError(Result))
+			{
+				OnError(FString::Printf(TEXT("Zstd: %s"), ANSI_TO_TCHAR(ZSTD_getErrorName(Result))));
+				bSucceed = false;
+				break;
+			}
+			if (Output.pos > 0)
+			{
+				OnChunkDecompressed(Out.GetData(), (int32)Output.pos);
+			}
+		}
+	}
+
+	ZSTD_freeDStream(DecompressionStream);
+	return bSucceed;
+#else
+	OnError(TEXT("Zstd: Not available in this build."));
+	return false;
+#endif
+}
+
+bool BFileCodec::Compress_Deflate(const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes)
+{
+	if (InSize > MAX_int32) return false;
+
+	int32 Offset = OutBytes.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, (int32)InSize);
+	OutBytes.AddUninitialized(CompressedSize);
+
+	if (!FCompression::CompressMemory(NAME_Zlib, OutBytes.GetData() + Offset, CompressedSize, InBytes, (int32)InSize)) return false;
+
+	OutBytes.SetNum(Offset + CompressedSize, false);
+	return true;
+}
+
+bool BFileCodec::Compress_LZ4(const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes)
+{
+	const int32 BlockBound = FCompression::CompressMemoryBound(NAME_LZ4, X_LZ4_BLOCK_SIZE);
+
+	for (int64 Offset = 0; Offset < InSize; Offset += X_LZ4_BLOCK_SIZE)
+	{
+		int32 BlockSizes[2]; //Uncompressed, compressed
+		BlockSizes[0] = (int32)FMath::Min<int64>(X_LZ4_BLOCK_SIZE, InSize - Offset);
+		BlockSizes[1] = BlockBound;
+
+		int32 BlockHeaderOffset = OutBytes.Num();
+		OutBytes.AddUninitialized(sizeof(BlockSizes) + BlockBound);
+
+		if (!FCompression::CompressMemory(NAME_LZ4, OutBytes.GetData() + BlockHeaderOffset + sizeof(BlockSizes), BlockSizes[1], InBytes + Offset, BlockSizes[0])) return false;
+
+		FMemory::Memcpy(OutBytes.GetData() + BlockHeaderOffset, BlockSizes, sizeof(BlockSizes));
+		OutBytes.SetNum(BlockHeaderOffset + sizeof(BlockSizes) + BlockSizes[1], false);
+	}
+	return true;
+}
+
+bool BFileCodec::Compress_Zstd(const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes)
+{
+#if BFILESDK_WITH_ZSTD
+	int32 Offset = OutBytes.Num();
+	size_t Bound = ZSTD_compressBound((size_t)InSize);
+	if (Bound > (size_t)(MAX_int32 - Offset)) return false;
+
+	OutBytes.AddUninitialized((int32)Bound);
+
+	size_t Result = ZSTD_compress(OutBytes.GetData() + Offset, Bound, InBytes, (size_t)InSize, X_ZSTD_COMPRESSION_LEVEL);
+	if (ZSTD_isError(Result)) return false;
+
+	OutBytes.SetNum(Offset + (int32)Result, false);
+	return true;
+#else
+	return false;
+#endif
+}
\ No newline at end of file
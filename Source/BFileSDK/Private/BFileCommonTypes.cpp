@@ -1,12 +1,25 @@
 /// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
 
 #include "BFileCommonTypes.h"
+#include "BFileHeader.h"
+#include "BFileVertexQuantization.h"
+#include "BFileIndexCodec.h"
 #include "Dom/JsonObject.h"
 #include "Serialization/JsonSerializer.h"
 
 #define XCopyFromBytes(HEAD, SRC, BUFF) if ((sizeof(SRC) + (HEAD - BUFF.GetData())) <= BUFF.Num()) { FMemory::Memcpy(&SRC, HEAD, sizeof(SRC)); HEAD += sizeof(SRC); } else return false;
 
-bool BNode::FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer)
+//Bulk variant: one bounds check for the whole array, then a single wide copy.
+#define XCopyArrayFromBytes(HEAD, DEST, COUNT, BUFF) if ((COUNT) >= 0 && ((int64)(COUNT) * (int64)sizeof(*(DEST)) + (HEAD - BUFF.GetData())) <= (int64)BUFF.Num()) { FMemory::Memcpy(DEST, HEAD, (SIZE_T)(COUNT) * sizeof(*(DEST))); HEAD += (SIZE_T)(COUNT) * sizeof(*(DEST)); } else return false;
+
+//Framing: reads a count at OFFSET if available; otherwise reports the bytes needed to see it.
+#define XPeekFromBytes(OFFSET, SRC, HEAD, AVAILABLE, NODESIZE) if ((int64)(OFFSET) + (int64)sizeof(SRC) <= (int64)(AVAILABLE)) { FMemory::Memcpy(&SRC, HEAD + (OFFSET), sizeof(SRC)); OFFSET += sizeof(SRC); } else { NODESIZE = (uint32)((OFFSET) + sizeof(SRC)); return EBNodeFramingResult_NeedMoreData; }
+#define XSkipFramedBytes(OFFSET, COUNT, AVAILABLE, NODESIZE) OFFSET += (COUNT); if (OFFSET > MAX_int32) return EBNodeFramingResult_Invalid; if (OFFSET > (int64)(AVAILABLE)) { NODESIZE = (uint32)OFFSET; return EBNodeFramingResult_NeedMoreData; }
+
+#define X_HIERARCHY_GEOMETRY_PART_SIZE (sizeof(uint64) + 9 * sizeof(float) + 3 * sizeof(uint8))
+#define X_GEOMETRY_VERTEX_NORMAL_TANGENT_SIZE (9 * sizeof(float))
+
+bool BNode::FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags)
 {
 	const uint8* Head = InHead;
 	XCopyFromBytes(Head, UniqueID, Buffer);
@@ -14,57 +27,172 @@ bool BNode::FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>
 	return true;
 }
 
-bool BMetadataNode::FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer)
+SIZE_T BNode::GetAllocatedSize() const
 {
-	const uint8* Head = InHead;
+	return sizeof(BNode);
+}
 
-	uint32 BaseNodeSize;
-	if (!BNode::FromBytes(BaseNodeSize, Head, Buffer)) return false;
-	Head += BaseNodeSize;
+BLazyMetadata::BLazyMetadata(const uint8* InUtf8, int32 InSize)
+	: Json(nullptr)
+{
+	SetTrimmed(InUtf8, InSize);
+}
 
-	int32 MetadataSize;
-	XCopyFromBytes(Head, MetadataSize, Buffer);
+BLazyMetadata::BLazyMetadata(const FString& InJson)
+	: Json(nullptr)
+{
+	FTCHARToUTF8 Converted(*InJson);
+	SetTrimmed((const uint8*)Converted.Get(), Converted.Length());
+}
 
-	TArray<uint8> MetadataContent;
-	MetadataContent.AddUninitialized(MetadataSize);
-	FMemory::Memcpy(MetadataContent.GetData(), Head, MetadataSize);
-	Head += MetadataSize;
+BLazyMetadata::~BLazyMetadata()
+{
+	delete Json.Load();
+}
+
+void BLazyMetadata::SetTrimmed(const uint8* InUtf8, int32 InSize)
+{
+	int32 First = 0;
+	while (First < InSize && InUtf8[First] != '{') First++;
 
-	FString MetadataString = ANSI_TO_TCHAR((ANSICHAR*)MetadataContent.GetData());
+	int32 Last = InSize - 1;
+	while (Last > First && InUtf8[Last] != '}') Last--;
 
-	//In case there are additional characters produced by decoding at the beginning or the end; trim them.
-	int32 IndexOfFirstExpectedChar = MetadataString.Find("{\"", ESearchCase::IgnoreCase, ESearchDir::FromStart);
-	if (IndexOfFirstExpectedChar > 0)
+	if (First < Last)
 	{
-		MetadataString = MetadataString.Mid(IndexOfFirstExpectedChar);
+		Utf8.Append(InUtf8 + First, Last - First + 1);
 	}
-	int32 IndexOfLastExpectedChar = MetadataString.Find("\"}", ESearchCase::IgnoreCase, ESearchDir::FromStart);
-	if (IndexOfLastExpectedChar > 0 && IndexOfLastExpectedChar < (MetadataString.Len() - 2)) /*sizeof("\"}")*/
+}
+
+FString BLazyMetadata::ToString() const
+{
+	if (Utf8.Num() == 0) return TEXT("{}");
+
+	FUTF8ToTCHAR Converted((const ANSICHAR*)Utf8.GetData(), Utf8.Num());
+	return FString(Converted.Length(), Converted.Get());
+}
+
+FString BLazyMetadata::ToValidatedString() const
+{
+	FString JsonString = ToString();
+
+	//Same reader as FJsonSerializer::Deserialize; it fails on malformed input and on anything after the root object.
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+	EJsonNotation Notation;
+	const bool bIsObject = Reader->ReadNext(Notation) && Notation == EJsonNotation::ObjectStart;
+	if (bIsObject)
+	{
+		while (Reader->ReadNext(Notation)) {}
+	}
+
+	if (!bIsObject || !Reader->GetErrorMessage().IsEmpty())
 	{
-		MetadataString = MetadataString.Mid(0, IndexOfLastExpectedChar + 2);
+		UE_LOG(LogTemp, Error, TEXT("BLazyMetadata::ToValidatedString: Invalid JSON is written as an empty object: %s"), *JsonString);
+		return TEXT("{}");
 	}
+	return JsonString;
+}
+
+TSharedPtr<FJsonObject, ESPMode::ThreadSafe> BLazyMetadata::GetJson() const
+{
+	TSharedPtr<FJsonObject, ESPMode::ThreadSafe>* Published = Json.Load();
+	if (Published != nullptr) return *Published;
+
+	FString JsonString = ToString();
 
-	TSharedPtr<FJsonObject> TmpObj;
-	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(MetadataString), TmpObj))
+	TSharedPtr<FJsonObject, ESPMode::ThreadSafe>* NewJson = new TSharedPtr<FJsonObject, ESPMode::ThreadSafe>();
+
+	TSharedPtr<FJsonObject> Parsed;
+	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(JsonString), Parsed) || !Parsed.IsValid())
 	{
-		UE_LOG(LogTemp, Error, TEXT("BMetadataNode::FromBytes: Deserialization failed: %s"), *MetadataString);
-		Metadata = MakeShareable(new FJsonObject);
+		UE_LOG(LogTemp, Error, TEXT("BLazyMetadata::GetJson: Deserialization failed: %s"), *JsonString);
+		*NewJson = MakeShareable(new FJsonObject);
 	}
 	else
 	{
-		Metadata = MakeShareable(new FJsonObject(*TmpObj.Get()));
+		//Thread-safe reference controller is required by the owners; the parsed object itself is moved, not copied.
+		*NewJson = MakeShareable(new FJsonObject(MoveTemp(*Parsed.Get())));
 	}
 
+	//Threads racing on the first parse all parse; the first to publish wins and the others use its object.
+	if (!Json.CompareExchange(Published, NewJson))
+	{
+		delete NewJson;
+		return *Published;
+	}
+	return *NewJson;
+}
+
+EBNodeFramingResult BMetadataNode::Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes, uint32 InHeaderFlags)
+{
+	int64 Offset = sizeof(uint64); //UniqueID
+
+	int32 MetadataSize;
+	XPeekFromBytes(Offset, MetadataSize, InHead, AvailableBytes, NodeSize);
+	if (MetadataSize < 0) return EBNodeFramingResult_Invalid;
+
+	XSkipFramedBytes(Offset, MetadataSize, AvailableBytes, NodeSize);
+
+	NodeSize = (uint32)Offset;
+	return EBNodeFramingResult_Complete;
+}
+
+bool BMetadataNode::FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags)
+{
+	const uint8* Head = InHead;
+
+	uint32 BaseNodeSize;
+	if (!BNode::FromBytes(BaseNodeSize, Head, Buffer, InHeaderFlags)) return false;
+	Head += BaseNodeSize;
+
+	int32 MetadataSize;
+	XCopyFromBytes(Head, MetadataSize, Buffer);
+	if (MetadataSize < 0 || (MetadataSize + (Head - Buffer.GetData())) > Buffer.Num()) return false;
+
+	//Single copy out of the stream buffer; parsing is deferred to first access.
+	Metadata = MakeShareable(new BLazyMetadata(Head, MetadataSize));
+	Head += MetadataSize;
+
 	NodeSize = Head - InHead;
 	return true;
 }
 
-bool BHierarchyNode::FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer)
+SIZE_T BMetadataNode::GetAllocatedSize() const
+{
+	SIZE_T Size = sizeof(BMetadataNode);
+	if (Metadata.IsValid())
+	{
+		Size += sizeof(BLazyMetadata) + Metadata->GetAllocatedSize();
+	}
+	return Size;
+}
+
+EBNodeFramingResult BHierarchyNode::Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes, uint32 InHeaderFlags)
+{
+	int64 Offset = 3 * sizeof(uint64); //UniqueID, ParentID, MetadataID
+
+	int32 GeometryPartsSize;
+	XPeekFromBytes(Offset, GeometryPartsSize, InHead, AvailableBytes, NodeSize);
+	if (GeometryPartsSize < 0) return EBNodeFramingResult_Invalid;
+
+	XSkipFramedBytes(Offset, (int64)GeometryPartsSize * X_HIERARCHY_GEOMETRY_PART_SIZE, AvailableBytes, NodeSize);
+
+	int32 ChildNodesSize;
+	XPeekFromBytes(Offset, ChildNodesSize, InHead, AvailableBytes, NodeSize);
+	if (ChildNodesSize < 0) return EBNodeFramingResult_Invalid;
+
+	XSkipFramedBytes(Offset, (int64)ChildNodesSize * sizeof(uint64), AvailableBytes, NodeSize);
+
+	NodeSize = (uint32)Offset;
+	return EBNodeFramingResult_Complete;
+}
+
+bool BHierarchyNode::FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags)
 {
 	const uint8* Head = InHead;
 	
 	uint32 BaseNodeSize;
-	if (!BNode::FromBytes(BaseNodeSize, Head, Buffer)) return false;
+	if (!BNode::FromBytes(BaseNodeSize, Head, Buffer, InHeaderFlags)) return false;
 	Head += BaseNodeSize;
 
 	XCopyFromBytes(Head, ParentID, Buffer);
@@ -94,57 +222,214 @@ bool BHierarchyNode::FromBytes(uint32& NodeSize, const uint8* InHead, const TArr
 	}
 	int32 ChildNodesSize;
 	XCopyFromBytes(Head, ChildNodesSize, Buffer);
-	ChildNodes.SetNum(ChildNodesSize);
-	for (int32 i = 0; i < ChildNodesSize; i++)
+	if (ChildNodesSize < 0) return false;
+	ChildNodes.SetNumUninitialized(ChildNodesSize);
+	XCopyArrayFromBytes(Head, ChildNodes.GetData(), ChildNodesSize, Buffer);
+
+	NodeSize = Head - InHead;
+	return true;
+}
+
+SIZE_T BHierarchyNode::GetAllocatedSize() const
+{
+	return sizeof(BHierarchyNode) + GeometryParts.GetAllocatedSize() + ChildNodes.GetAllocatedSize();
+}
+
+EBNodeFramingResult BGeometryNode::Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes, uint32 InHeaderFlags)
+{
+	int64 Offset = sizeof(uint64); //UniqueID
+
+	int8 LODCount;
+	XPeekFromBytes(Offset, LODCount, InHead, AvailableBytes, NodeSize);
+	if (LODCount < 0) return EBNodeFramingResult_Invalid;
+
+	const bool bQuantized = (InHeaderFlags & EBFileHeaderFlags_QuantizedGeometry) != 0;
+	const bool bEncodedIndexes = (InHeaderFlags & EBFileHeaderFlags_EncodedIndexes) != 0;
+	if (bQuantized && LODCount > 0)
 	{
-		XCopyFromBytes(Head, ChildNodes[i], Buffer);
+		XSkipFramedBytes(Offset, X_QUANTIZED_BOUNDS_SIZE, AvailableBytes, NodeSize);
 	}
+	const int64 VertexSize = bQuantized ? X_QUANTIZED_VERTEX_SIZE : X_GEOMETRY_VERTEX_NORMAL_TANGENT_SIZE;
 
-	NodeSize = Head - InHead;
+	for (int8 i = 0; i < LODCount; i++)
+	{
+		int32 VNTCount;
+		XPeekFromBytes(Offset, VNTCount, InHead, AvailableBytes, NodeSize);
+		if (VNTCount < 0) return EBNodeFramingResult_Invalid;
+
+		XSkipFramedBytes(Offset, (int64)VNTCount * VertexSize, AvailableBytes, NodeSize);
+
+		int32 IndexedTrianglesCount;
+		XPeekFromBytes(Offset, IndexedTrianglesCount, InHead, AvailableBytes, NodeSize);
+		if (IndexedTrianglesCount < 0) return EBNodeFramingResult_Invalid;
+
+		if (bEncodedIndexes)
+		{
+			int32 EncodedSize;
+			XPeekFromBytes(Offset, EncodedSize, InHead, AvailableBytes, NodeSize);
+
+			//Every triangle takes at least its code byte.
+			if (EncodedSize < 0 || IndexedTrianglesCount % 3 != 0 || IndexedTrianglesCount / 3 > EncodedSize) return EBNodeFramingResult_Invalid;
+
+			XSkipFramedBytes(Offset, EncodedSize, AvailableBytes, NodeSize);
+		}
+		else
+		{
+			XSkipFramedBytes(Offset, (int64)IndexedTrianglesCount * sizeof(uint32), AvailableBytes, NodeSize);
+		}
+	}
+
+	NodeSize = (uint32)Offset;
+	return EBNodeFramingResult_Complete;
+}
+
+static_assert(sizeof(BGeometryNode::BLOD::BVertexNormalTangent) == X_GEOMETRY_VERTEX_NORMAL_TANGENT_SIZE, "BVertexNormalTangent must match its byte layout for bulk decoding.");
+
+//Max-reduction over independent lanes without branches; compilers turn the inner loop into packed max instructions.
+static bool AreIndexesInRange(const uint32* Indexes, int32 IndexCount, int32 VertexCount)
+{
+	if (IndexCount == 0) return true;
+	if (VertexCount == 0) return false;
+
+	constexpr int32 LaneCount = 8;
+	uint32 LaneMax[LaneCount] = { 0 };
+
+	int32 i = 0;
+	for (; i + LaneCount <= IndexCount; i += LaneCount)
+	{
+		for (int32 Lane = 0; Lane < LaneCount; Lane++)
+		{
+			const uint32 Value = Indexes[i + Lane];
+			LaneMax[Lane] = Value > LaneMax[Lane] ? Value : LaneMax[Lane];
+		}
+	}
+
+	uint32 MaxIndex = 0;
+	for (; i < IndexCount; i++)
+	{
+		MaxIndex = Indexes[i] > MaxIndex ? Indexes[i] : MaxIndex;
+	}
+	for (int32 Lane = 0; Lane < LaneCount; Lane++)
+	{
+		MaxIndex = LaneMax[Lane] > MaxIndex ? LaneMax[Lane] : MaxIndex;
+	}
+
+	return MaxIndex < (uint32)VertexCount;
+}
+
+//Decodes VertexCount quantized vertices at Head into the packed arrays of LOD and advances Head.
+static bool DecodeQuantizedVertices(BGeometryNode::BLOD& LOD, const uint8*& Head, int32 VertexCount, const float Bounds[6], TArrayView<const uint8> Buffer)
+{
+	if ((int64)VertexCount * X_QUANTIZED_VERTEX_SIZE + (Head - Buffer.GetData()) > (int64)Buffer.Num()) return false;
+
+	LOD.Positions.SetNumUninitialized(VertexCount);
+	LOD.TangentX.SetNumUninitialized(VertexCount);
+	LOD.TangentZ.SetNumUninitialized(VertexCount);
+
+	for (int32 i = 0; i < VertexCount; i++)
+	{
+		uint16 Position[3];
+		int16 Octahedral[4]; //Normal XY, Tangent XY
+		FMemory::Memcpy(Position, Head, sizeof(Position));
+		FMemory::Memcpy(Octahedral, Head + sizeof(Position), sizeof(Octahedral));
+		Head += X_QUANTIZED_VERTEX_SIZE;
+
+		LOD.Positions[i] = FVector(
+			BFileVertexQuantization::DequantizePosition(Position[0], Bounds[0], Bounds[3]),
+			BFileVertexQuantization::DequantizePosition(Position[1], Bounds[1], Bounds[4]),
+			BFileVertexQuantization::DequantizePosition(Position[2], Bounds[2], Bounds[5]));
+
+		LOD.TangentZ[i] = FPackedNormal(FVector4(BFileVertexQuantization::DecodeOctahedral(Octahedral[0], Octahedral[1]), 1.0f));
+		LOD.TangentX[i] = FPackedNormal(BFileVertexQuantization::DecodeOctahedral(Octahedral[2], Octahedral[3]));
+	}
 	return true;
 }
 
-bool BGeometryNode::FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer)
+bool BGeometryNode::FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags)
 {
 	const uint8* Head = InHead;
 
 	uint32 BaseNodeSize;
-	if (!BNode::FromBytes(BaseNodeSize, Head, Buffer)) return false;
+	if (!BNode::FromBytes(BaseNodeSize, Head, Buffer, InHeaderFlags)) return false;
 	Head += BaseNodeSize;
 
 	int8 LODCount;
 	XCopyFromBytes(Head, LODCount, Buffer);
+	if (LODCount < 0) return false;
 	LODs.SetNum(LODCount);
 
+	const bool bQuantized = (InHeaderFlags & EBFileHeaderFlags_QuantizedGeometry) != 0;
+	const bool bEncodedIndexes = (InHeaderFlags & EBFileHeaderFlags_EncodedIndexes) != 0;
+
+	float Bounds[6]; //Min XYZ, Extent XYZ
+	if (bQuantized && LODCount > 0)
+	{
+		XCopyFromBytes(Head, Bounds, Buffer);
+	}
+
 	for (int8 i = 0; i < LODCount; i++)
 	{
+		auto& LOD = LODs[i];
+		LOD.bPackedVertices = bQuantized;
+
 		int32 VNTCount;
 		XCopyFromBytes(Head, VNTCount, Buffer);
-		LODs[i].VertexNormalTangentList.SetNum(VNTCount);
-		for (int32 j = 0; j < VNTCount; j++)
-		{
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Vertex.X, Buffer);
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Vertex.Y, Buffer);
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Vertex.Z, Buffer);
-
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Normal.X, Buffer);
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Normal.Y, Buffer);
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Normal.Z, Buffer);
+		if (VNTCount < 0) return false;
 
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Tangent.X, Buffer);
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Tangent.Y, Buffer);
-			XCopyFromBytes(Head, LODs[i].VertexNormalTangentList[j].Tangent.Z, Buffer);
+		if (bQuantized)
+		{
+			if (!DecodeQuantizedVertices(LOD, Head, VNTCount, Bounds, Buffer)) return false;
+			LOD.VertexNormalTangentList.Reset();
+		}
+		else
+		{
+			LOD.VertexNormalTangentList.SetNumUninitialized(VNTCount);
+			XCopyArrayFromBytes(Head, LOD.VertexNormalTangentList.GetData(), VNTCount, Buffer);
+			LOD.Positions.Reset();
+			LOD.TangentX.Reset();
+			LOD.TangentZ.Reset();
 		}
 
 		int32 IndexedTrianglesCount;
 		XCopyFromBytes(Head, IndexedTrianglesCount, Buffer);
-		LODs[i].Indexes.SetNumUninitialized(IndexedTrianglesCount);
-		for (int32 j = 0; j < IndexedTrianglesCount; j++)
+		if (IndexedTrianglesCount < 0) return false;
+
+		//Counts are checked against the bytes behind them before anything is allocated.
+		if (bEncodedIndexes)
+		{
+			int32 EncodedSize;
+			XCopyFromBytes(Head, EncodedSize, Buffer);
+			if (EncodedSize < 0 || (int64)EncodedSize + (Head - Buffer.GetData()) > (int64)Buffer.Num()) return false;
+			if (IndexedTrianglesCount % 3 != 0 || IndexedTrianglesCount / 3 > EncodedSize) return false;
+
+			LOD.Indexes.SetNumUninitialized(IndexedTrianglesCount);
+
+			//Decodes straight into the node's array; range checks are part of decoding.
+			if (!BFileIndexCodec::Decode(Head, EncodedSize, LOD.Indexes.GetData(), IndexedTrianglesCount, VNTCount)) return false;
+			Head += EncodedSize;
+		}
+		else
 		{
-			XCopyFromBytes(Head, LODs[i].Indexes[j], Buffer);
+			if ((int64)IndexedTrianglesCount * sizeof(uint32) + (Head - Buffer.GetData()) > (int64)Buffer.Num()) return false;
+
+			LOD.Indexes.SetNumUninitialized(IndexedTrianglesCount);
+			XCopyArrayFromBytes(Head, LOD.Indexes.GetData(), IndexedTrianglesCount, Buffer);
+
+			if (!AreIndexesInRange(LOD.Indexes.GetData(), IndexedTrianglesCount, VNTCount)) return false;
 		}
 	}
 
 	NodeSize = Head - InHead;
 	return true;
+}
+
+SIZE_T BGeometryNode::GetAllocatedSize() const
+{
+	SIZE_T Size = sizeof(BGeometryNode) + LODs.GetAllocatedSize();
+	for (const BLOD& LOD : LODs)
+	{
+		Size += LOD.VertexNormalTangentList.GetAllocatedSize() + LOD.Indexes.GetAllocatedSize()
+			+ LOD.Positions.GetAllocatedSize() + LOD.TangentX.GetAllocatedSize() + LOD.TangentZ.GetAllocatedSize();
+	}
+	return Size;
 }
\ No newline at end of file
@@ -2,15 +2,108 @@
 
 #include "BFileFinalTypes.h"
 #include "BFileCommonTypes.h"
+#include "BFileImportTelemetry.h"
 #include "Serialization/ArchiveSaveCompressedProxy.h"
 #include "Serialization/ArchiveLoadCompressedProxy.h"
-#include "Dom/JsonObject.h"
-#include "Serialization/JsonSerializer.h"
 #include "BLambdaRunnable.h"
+#include "BFileBlockContainer.h"
+
+static_assert(sizeof(FQuat) == 4 * sizeof(float) && sizeof(FVector) == 3 * sizeof(float) && sizeof(FColor) == 4, "Bulk hierarchy columns are written as raw memory.");
+
+//Element counts are written by the caller; all elements are written or read in one call.
+template<typename ElementType>
+static void SaveBulk(FArchive& Ar, const TArray<ElementType>& Array, int32 Num)
+{
+	check(Ar.IsSaving() && Array.Num() == Num);
+	Ar.Serialize(const_cast<ElementType*>(Array.GetData()), (int64)Num * sizeof(ElementType));
+}
+
+template<typename ElementType>
+static void LoadBulk(FArchive& Ar, TArray<ElementType>& Array, int32 Num)
+{
+	check(Ar.IsLoading());
+	Array.SetNumUninitialized(Num);
+	Ar.Serialize(Array.GetData(), (int64)Num * sizeof(ElementType));
+}
+
+//Per node: ID, parent, metadata ID, part count. Per part: geometry ID, rotation, translation, scale, color.
+#define X_BULK_HIERARCHY_NODE_BYTES (sizeof(int64) + sizeof(int32) + sizeof(int64) + sizeof(int32))
+#define X_BULK_HIERARCHY_PART_BYTES (sizeof(int64) + sizeof(FQuat) + sizeof(FVector) + sizeof(FVector) + sizeof(FColor))
+
+int32 BFinalAssetContent::GetChildCount(int32 InNode) const
+{
+	int32 Count = 0;
+	for (int32 Child = HierarchyFirstChildren[InNode]; Child != INDEX_NONE; Child = HierarchyNextSiblings[Child])
+	{
+		Count++;
+	}
+	return Count;
+}
+
+int32 BFinalAssetContent::AddHierarchyNode(int64 InUniqueID, int32 InParent, int32 InPreviousSibling, int32 InMetadata)
+{
+	const int32 Index = HierarchyIDs.Add(InUniqueID);
+	HierarchyParents.Add(InParent);
+	HierarchyFirstChildren.Add(INDEX_NONE);
+	HierarchyNextSiblings.Add(INDEX_NONE);
+	HierarchyMetadata.Add(InMetadata);
+	HierarchyFirstParts.Add(PartGeometries.Num());
+	HierarchyPartCounts.Add(0);
+
+	if (InPreviousSibling != INDEX_NONE)
+	{
+		HierarchyNextSiblings[InPreviousSibling] = Index;
+	}
+	else if (InParent != INDEX_NONE)
+	{
+		HierarchyFirstChildren[InParent] = Index;
+	}
+	return Index;
+}
+
+int32 BFinalAssetContent::AddPart(int32 InGeometry, const FTransform& InTransform, const FColor& InColor)
+{
+	HierarchyPartCounts.Last()++;
+
+	PartTransforms.Add(InTransform);
+	PartColors.Add(InColor);
+	PartInstanceIndexes.Add(INDEX_NONE);
+	return PartGeometries.Add(InGeometry);
+}
+
+int32 BFinalAssetContent::AddGeometryNode(int64 InUniqueID, TArray<uint8>&& InSerializedRenderData)
+{
+	GeometrySerializedRenderData.Add(MoveTemp(InSerializedRenderData));
+	return GeometryIDs.Add(InUniqueID);
+}
+
+int32 BFinalAssetContent::AddMetadataNode(int64 InUniqueID, TSharedPtr<BLazyMetadata, ESPMode::ThreadSafe> InMetadata)
+{
+	Metadata.Add(InMetadata);
+	return MetadataIDs.Add(InUniqueID);
+}
+
+void BFinalAssetContent::ReserveHierarchyNodes(int32 InNodeCount, int32 InPartCount)
+{
+	HierarchyIDs.Reserve(InNodeCount);
+	HierarchyParents.Reserve(InNodeCount);
+	HierarchyFirstChildren.Reserve(InNodeCount);
+	HierarchyNextSiblings.Reserve(InNodeCount);
+	HierarchyMetadata.Reserve(InNodeCount);
+	HierarchyFirstParts.Reserve(InNodeCount);
+	HierarchyPartCounts.Reserve(InNodeCount);
+
+	PartGeometries.Reserve(InPartCount);
+	PartTransforms.Reserve(InPartCount);
+	PartColors.Reserve(InPartCount);
+	PartInstanceIndexes.Reserve(InPartCount);
+}
 
 bool BFinalAssetContent::XSerialize(EBFileOutputFormat OutputFormat, TFunction<FBFileOutputBufferAlternative(int64)> OutputBuffer)
 {
-	if (RootNode == nullptr) return false;
+	if (!HasRoot()) return false;
+
+	BFileImportTelemetry::FBScope XSerializeScope(Telemetry, EBImportTimer_XSerialize);
 
 	if (OutputFormat != EBFileOutputFormat::Gs)
 	{
@@ -24,19 +117,21 @@ bool BFinalAssetContent::XSerialize(EBFileOutputFormat OutputFormat, TFunction<F
 
 bool BFinalAssetContent::XSerialize_Gs(TFunction<FBFileOutputBufferAlternative(int64)> OutputBuffer)
 {
-	if (GeometryIDToNodeMap.Num() == 0) return false;
+	if (GeometryIDs.Num() == 0) return false;
 
 	bool* bSucceedPtr = new bool(true);
 
-	FThreadSafeCounter* UncompletedTasksCount = new FThreadSafeCounter(GeometryIDToNodeMap.Num());
+	FThreadSafeCounter* UncompletedTasksCount = new FThreadSafeCounter(GeometryIDs.Num());
 	FEvent* CompletedEvent = FGenericPlatformProcess::GetSynchEventFromPool();
 
-	for (auto& GPair : GeometryIDToNodeMap)
+	for (int32 GeometryIndex = 0; GeometryIndex < GeometryIDs.Num(); GeometryIndex++)
 	{
-		const int64 ConstGUniqueID = GPair.Key;
-		BFinalGeometryNode* GNodePtr = GPair.Value.Get();
+		const int64 ConstGUniqueID = GeometryIDs[GeometryIndex];
+		TArray<uint8>* GSerializedPtr = &GeometrySerializedRenderData[GeometryIndex];
+
+		BFileImportTelemetry* TelemetryPtr = Telemetry;
 
-		FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([ConstGUniqueID, GNodePtr, OutputBuffer, UncompletedTasksCount, CompletedEvent, bSucceedPtr]()
+		FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([ConstGUniqueID, GSerializedPtr, OutputBuffer, UncompletedTasksCount, CompletedEvent, bSucceedPtr, TelemetryPtr]()
 			{
 				if (*bSucceedPtr == false)
 				{
@@ -92,12 +187,16 @@ bool BFinalAssetContent::XSerialize_Gs(TFunction<FBFileOutputBufferAlternative(i
 
 				Serializer << GUniqueID;
 
-				auto& GSerialized = GNodePtr->SerializedRenderData;
-				Serializer << GSerialized;
+				Serializer << *GSerializedPtr;
 				//Serialization ends
 
 				Serializer.Flush();
 
+				if (TelemetryPtr)
+				{
+					TelemetryPtr->Add(EBImportCounter_OutputBytes, DestBufferPtr->Num());
+				}
+
 				if (bWriteBufferToStream)
 				{
 					WriteToStream->write((char*)DestBufferPtr->GetData(), DestBufferPtr->Num());
@@ -128,12 +227,10 @@ bool BFinalAssetContent::XSerialize_Others(EBFileOutputFormat OutputFormat, TFun
 {
 	static int64 IgnoreFileNodeID = 0; //Only meaningful for Gs
 
-	TArray<uint8>* DestBufferPtr;
-	bool bDeleteDestBufferPtr = false;
+	TArray<uint8>* DestBufferPtr = nullptr;
 
 	std::ostream* WriteToStream = nullptr;
 	TFunction<void()> StreamDoneWritingCallback = nullptr;
-	bool bWriteBufferToStream = false;
 
 	FBFileOutputBufferAlternative GeneratedDestBuffer = OutputBuffer(IgnoreFileNodeID);
 
@@ -144,6 +241,7 @@ bool BFinalAssetContent::XSerialize_Others(EBFileOutputFormat OutputFormat, TFun
 		{
 			return false;
 		}
+		DestBufferPtr->Empty();
 	}
 	else
 	{
@@ -153,52 +251,53 @@ bool BFinalAssetContent::XSerialize_Others(EBFileOutputFormat OutputFormat, TFun
 		{
 			return false;
 		}
-
-		DestBufferPtr = new TArray<uint8>();
-		bDeleteDestBufferPtr = true;
-		bWriteBufferToStream = true;
 	}
 
-	DestBufferPtr->Empty();
+	//Compressed blocks go straight to the destination, in order, as they complete.
+	BFileBlockContainerWriter Serializer([DestBufferPtr, WriteToStream](const uint8* Bytes, int64 Size)
+		{
+			if (WriteToStream != nullptr)
+			{
+				WriteToStream->write((const char*)Bytes, Size);
+				return !WriteToStream->fail();
+			}
+			if (DestBufferPtr->Num() + Size > MAX_int32) return false;
 
-	FArchiveSaveCompressedProxy Serializer = FArchiveSaveCompressedProxy(*DestBufferPtr, NAME_Zlib, COMPRESS_BiasMemory);
+			DestBufferPtr->Append(Bytes, (int32)Size);
+			return true;
+		}, Telemetry);
 	Serializer.SetFilterEditorOnly(true);
 
 	//Serialization starts
-	uint8 OutputFormatAsByte = (uint8)OutputFormat;
+	uint8 OutputFormatAsByte = (uint8)OutputFormat | X_OUTPUT_FORMAT_FLAG_BULK_HIERARCHY;
 	Serializer << OutputFormatAsByte;
 
 	if (OutputFormat == EBFileOutputFormat::HGM || OutputFormat == EBFileOutputFormat::HG)
 	{
-		int32 NumGeometryNodes = GeometryIDToNodeMap.Num();
+		int32 NumGeometryNodes = GeometryIDs.Num();
 		Serializer << NumGeometryNodes;
 
-		for (auto& GPair : GeometryIDToNodeMap)
+		for (int32 i = 0; i < NumGeometryNodes; i++)
 		{
-			int64 GUniqueID = GPair.Key;
-			Serializer << GUniqueID;
-
-			auto& GSerialized = GPair.Value->SerializedRenderData;
-			Serializer << GSerialized;
+			Serializer << GeometryIDs[i];
+			Serializer << GeometrySerializedRenderData[i];
 		}
 	}
 	
 	if (OutputFormat == EBFileOutputFormat::HGM)
 	{
-		int32 NumMetadataNodes = MetadataIDToNodeMap.Num();
+		int32 NumMetadataNodes = MetadataIDs.Num();
 		Serializer << NumMetadataNodes;
 
-		for (auto& MPair : MetadataIDToNodeMap)
+		for (int32 i = 0; i < NumMetadataNodes; i++)
 		{
-			int64 MUniqueID = MPair.Key;
-			Serializer << MUniqueID;
+			Serializer << MetadataIDs[i];
 
+			//Raw JSON text is written as it was read once it is validated; metadata that was never accessed is never parsed into a DOM.
 			FString MetadataString;
-			if (MPair.Value.IsValid() && MPair.Value->Metadata.IsValid())
+			if (Metadata[i].IsValid())
 			{
-				TSharedPtr<FJsonObject> TmpObj = MakeShareable(new FJsonObject(*MPair.Value->Metadata.Get()));
-				TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&MetadataString);
-				FJsonSerializer::Serialize(TmpObj.ToSharedRef(), Writer);
+				MetadataString = Metadata[i]->ToValidatedString();
 			}
 			else
 			{
@@ -208,78 +307,93 @@ bool BFinalAssetContent::XSerialize_Others(EBFileOutputFormat OutputFormat, TFun
 		}
 	}
 	
-	XSerialize_Recursive(Serializer, RootNode);
+	XSerialize_Hierarchy(Serializer);
 	//Serialization ends
 
-	Serializer.Flush();
+	const bool bSucceed = Serializer.Finish();
 
-	if (bWriteBufferToStream)
+	if (Telemetry)
 	{
-		WriteToStream->write((char*)DestBufferPtr->GetData(), DestBufferPtr->Num());
-		if (StreamDoneWritingCallback)
-		{
-			StreamDoneWritingCallback();
-		}
+		Telemetry->Add(EBImportCounter_OutputBytes, Serializer.GetContainerSize());
 	}
-	if (bDeleteDestBufferPtr)
+
+	//The stream is closed by its callback; the consumer waits for that even when the output failed.
+	if (StreamDoneWritingCallback)
 	{
-		delete DestBufferPtr;
+		StreamDoneWritingCallback();
 	}
-	return true;
+	return bSucceed;
 }
 
-void BFinalAssetContent::XSerialize_Recursive(FArchiveSaveCompressedProxy& Serializer, TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> Node)
+void BFinalAssetContent::XSerialize_Hierarchy(FArchive& Serializer) const
 {
-	auto Pinned = Node.Pin();
-
-	int64 HUniqueID = Pinned->UniqueID;
-	Serializer << HUniqueID;
-
-	int64 ParentHUniqueID = Pinned->Parent.IsValid() ? Pinned->Parent.Pin()->UniqueID : UNDEFINED_ID;
-	Serializer << ParentHUniqueID;
-
-	int64 MUniqueID = Pinned->Metadata.Pin()->UniqueID;
-	Serializer << MUniqueID;
-
-	int32 NumGeometries = Pinned->Geometries.Num();
-	Serializer << NumGeometries;
-
-	for (int32 i = 0; i < NumGeometries; i++)
+	//Breadth-first order is the memory order; every column is written with a single call.
+	int32 NumNodes = HierarchyIDs.Num();
+	int32 NumParts = PartGeometries.Num();
+	Serializer << NumNodes;
+	Serializer << NumParts;
+
+	//References are written as IDs; H and HG files do not carry the nodes they point to.
+	TArray<int64> NodeMetadataIDs;
+	NodeMetadataIDs.SetNumUninitialized(NumNodes);
+	for (int32 i = 0; i < NumNodes; i++)
 	{
-		auto GPart = Pinned->Geometries[i];
-
-		int64 GUniqueID = GPart->GeometryNode.Pin()->UniqueID;
-		Serializer << GUniqueID;
+		NodeMetadataIDs[i] = HierarchyMetadata[i] != INDEX_NONE ? MetadataIDs[HierarchyMetadata[i]] : UNDEFINED_ID;
+	}
 
-		auto& Transform = GPart->Transform;
-		Serializer << Transform;
+	TArray<int64> PartGeometryIDs;
+	TArray<FQuat> PartRotations;
+	TArray<FVector> PartTranslations;
+	TArray<FVector> PartScales;
+	PartGeometryIDs.SetNumUninitialized(NumParts);
+	PartRotations.SetNumUninitialized(NumParts);
+	PartTranslations.SetNumUninitialized(NumParts);
+	PartScales.SetNumUninitialized(NumParts);
+	for (int32 i = 0; i < NumParts; i++)
+	{
+		PartGeometryIDs[i] = PartGeometries[i] != INDEX_NONE ? GeometryIDs[PartGeometries[i]] : UNDEFINED_ID;
 
-		auto& Color = GPart->Color;
-		Serializer << Color;
+		PartRotations[i] = PartTransforms[i].GetRotation();
+		PartTranslations[i] = PartTransforms[i].GetTranslation();
+		PartScales[i] = PartTransforms[i].GetScale3D();
 	}
 
-	int32 NumChildren = Pinned->Children.Num();
-	Serializer << NumChildren;
+	SaveBulk(Serializer, HierarchyIDs, NumNodes);
+	SaveBulk(Serializer, HierarchyParents, NumNodes);
+	SaveBulk(Serializer, NodeMetadataIDs, NumNodes);
+	SaveBulk(Serializer, HierarchyPartCounts, NumNodes);
 
-	for (int32 i = 0; i < NumChildren; i++)
-	{
-		XSerialize_Recursive(Serializer, Pinned->Children[i]);
-	}
+	SaveBulk(Serializer, PartGeometryIDs, NumParts);
+	SaveBulk(Serializer, PartRotations, NumParts);
+	SaveBulk(Serializer, PartTranslations, NumParts);
+	SaveBulk(Serializer, PartScales, NumParts);
+	SaveBulk(Serializer, PartColors, NumParts);
 }
 
 void BFinalAssetContent::XDeserialize(const TArray<uint8>& SrcBuffer)
 {
-	FArchiveLoadCompressedProxy Deserializer = FArchiveLoadCompressedProxy(SrcBuffer, NAME_Zlib);
+	TUniquePtr<FArchive> DeserializerPtr;
+	if (BFileBlockContainerReader::IsBlockContainer(SrcBuffer))
+	{
+		DeserializerPtr = MakeUnique<BFileBlockContainerReader>(SrcBuffer);
+		if (DeserializerPtr->IsError()) return;
+	}
+	else
+	{
+		DeserializerPtr = MakeUnique<FArchiveLoadCompressedProxy>(SrcBuffer, NAME_Zlib);
+	}
+	FArchive& Deserializer = *DeserializerPtr;
 	Deserializer.SetFilterEditorOnly(true);
 
 	//Deserialization starts
 	uint8 OutputFormatAsByte;
 	Deserializer << OutputFormatAsByte;
-	EBFileOutputFormat OutputFormat = (EBFileOutputFormat)OutputFormatAsByte;
+	EBFileOutputFormat OutputFormat = (EBFileOutputFormat)(OutputFormatAsByte & ~X_OUTPUT_FORMAT_FLAG_BULK_HIERARCHY);
+	const bool bBulkHierarchy = (OutputFormatAsByte & X_OUTPUT_FORMAT_FLAG_BULK_HIERARCHY) != 0;
 	
 	if (OutputFormat != EBFileOutputFormat::Gs)
 	{
-		XDeserialize_Others(OutputFormat, Deserializer);
+		XDeserialize_Others(OutputFormat, bBulkHierarchy, Deserializer);
 	}
 	else
 	{
@@ -288,34 +402,40 @@ void BFinalAssetContent::XDeserialize(const TArray<uint8>& SrcBuffer)
 	//Deserialization ends
 }
 
-void BFinalAssetContent::XDeserialize_Gs(FArchiveLoadCompressedProxy& Deserializer)
+void BFinalAssetContent::XDeserialize_Gs(FArchive& Deserializer)
 {
-	TSharedPtr<BFinalGeometryNode, ESPMode::ThreadSafe> NewGNode = MakeShareable(new BFinalGeometryNode);
+	int64 GUniqueID;
+	Deserializer << GUniqueID;
 
-	Deserializer << NewGNode->UniqueID;
+	TArray<uint8> SerializedRenderData;
+	Deserializer << SerializedRenderData;
 
-	Deserializer << NewGNode->SerializedRenderData;
-
-	GeometryIDToNodeMap.Add(NewGNode->UniqueID, NewGNode);
+	AddGeometryNode(GUniqueID, MoveTemp(SerializedRenderData));
 }
 
-void BFinalAssetContent::XDeserialize_Others(EBFileOutputFormat OutputFormat, FArchiveLoadCompressedProxy& Deserializer)
+void BFinalAssetContent::XDeserialize_Others(EBFileOutputFormat OutputFormat, bool bBulkHierarchy, FArchive& Deserializer)
 {
+	//Only used while deserializing; IDs that are not in the file (H and HG formats) resolve to INDEX_NONE.
+	TMap<int64, int32> GeometryIDToIndex;
+	TMap<int64, int32> MetadataIDToIndex;
+
 	if (OutputFormat == EBFileOutputFormat::HGM || OutputFormat == EBFileOutputFormat::HG)
 	{
 		int32 NumGeometryNodes;
 		Deserializer << NumGeometryNodes;
 
-		GeometryIDToNodeMap.Empty(NumGeometryNodes);
-		for (int32 i = 0; i < NumGeometryNodes; i++)
+		GeometryIDs.Reserve(NumGeometryNodes);
+		GeometrySerializedRenderData.Reserve(NumGeometryNodes);
+		GeometryIDToIndex.Reserve(NumGeometryNodes);
+		for (int32 i = 0; i < NumGeometryNodes && !Deserializer.IsError(); i++)
 		{
-			TSharedPtr<BFinalGeometryNode, ESPMode::ThreadSafe> NewGNode = MakeShareable(new BFinalGeometryNode);
-
-			Deserializer << NewGNode->UniqueID;
+			int64 GUniqueID;
+			Deserializer << GUniqueID;
 
-			Deserializer << NewGNode->SerializedRenderData;
+			TArray<uint8> SerializedRenderData;
+			Deserializer << SerializedRenderData;
 
-			GeometryIDToNodeMap.Add(NewGNode->UniqueID, NewGNode);
+			GeometryIDToIndex.Add(GUniqueID, AddGeometryNode(GUniqueID, MoveTemp(SerializedRenderData)));
 		}
 	}
 
@@ -324,75 +444,264 @@ void BFinalAssetContent::XDeserialize_Others(EBFileOutputFormat OutputFormat, FA
 		int32 NumMetadataNodes;
 		Deserializer << NumMetadataNodes;
 
-		MetadataIDToNodeMap.Empty(NumMetadataNodes);
-		for (int32 i = 0; i < NumMetadataNodes; i++)
+		MetadataIDs.Reserve(NumMetadataNodes);
+		Metadata.Reserve(NumMetadataNodes);
+		MetadataIDToIndex.Reserve(NumMetadataNodes);
+		for (int32 i = 0; i < NumMetadataNodes && !Deserializer.IsError(); i++)
 		{
-			TSharedPtr<BFinalMetadataNode, ESPMode::ThreadSafe> NewMNode = MakeShareable(new BFinalMetadataNode);
-
-			Deserializer << NewMNode->UniqueID;
+			int64 MUniqueID;
+			Deserializer << MUniqueID;
 
 			FString MetadataString;
 			Deserializer << MetadataString;
 
-			TSharedPtr<FJsonObject> TmpObj;
-			if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(MetadataString), TmpObj))
-			{
-				UE_LOG(LogTemp, Error, TEXT("BFinalAssetContent::XDeserialize_Others: Deserialization failed: %s"), *MetadataString);
-				NewMNode->Metadata = MakeShareable(new FJsonObject);
-			}
-			else
-			{
-				NewMNode->Metadata = MakeShareable(new FJsonObject(*TmpObj.Get()));
-			}
-
-			MetadataIDToNodeMap.Add(NewMNode->UniqueID, NewMNode);
+			MetadataIDToIndex.Add(MUniqueID, AddMetadataNode(MUniqueID, MakeShareable(new BLazyMetadata(MetadataString))));
 		}
 	}
 
-	RootNode = XDeserialize_Recursive(Deserializer);
+	if (bBulkHierarchy)
+	{
+		XDeserialize_Hierarchy(Deserializer, GeometryIDToIndex, MetadataIDToIndex);
+	}
+	else
+	{
+		XDeserialize_NestedHierarchy(Deserializer, GeometryIDToIndex, MetadataIDToIndex);
+	}
 }
 
-TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> BFinalAssetContent::XDeserialize_Recursive(FArchiveLoadCompressedProxy& Deserializer)
+void BFinalAssetContent::XDeserialize_NestedHierarchy(FArchive& Deserializer, const TMap<int64, int32>& GeometryIDToIndex, const TMap<int64, int32>& MetadataIDToIndex)
 {
-	TSharedPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> NewHNode = MakeShareable(new BFinalHiearchyNode);
+	//Nested layout read without recursion; a frame per node whose children are still being read.
+	struct FBOpenNode
+	{
+		int32 Index;
+		int32 RemainingChildren;
+		int32 LastChild;
+	};
+	TArray<FBOpenNode> OpenNodes;
+
+	do
+	{
+		const int32 Parent = OpenNodes.Num() > 0 ? OpenNodes.Last().Index : INDEX_NONE;
+		const int32 PreviousSibling = OpenNodes.Num() > 0 ? OpenNodes.Last().LastChild : INDEX_NONE;
 
-	Deserializer << NewHNode->UniqueID;
-	HierarchyIDToNodeMap.Add(NewHNode->UniqueID, NewHNode);
+		int64 HUniqueID;
+		Deserializer << HUniqueID;
 
-	int64 ParentHUniqueID;
-	Deserializer << ParentHUniqueID;
-	NewHNode->Parent = ParentHUniqueID == UNDEFINED_ID ? nullptr : HierarchyIDToNodeMap[ParentHUniqueID];
+		//Structure tells the parent already
+		int64 ParentHUniqueID;
+		Deserializer << ParentHUniqueID;
 
-	int64 MUniqueID;
-	Deserializer << MUniqueID;
-	NewHNode->Metadata = MetadataIDToNodeMap[MUniqueID];
+		int64 MUniqueID;
+		Deserializer << MUniqueID;
+		const int32* MetadataIndex = MetadataIDToIndex.Find(MUniqueID);
+
+		const int32 Index = AddHierarchyNode(HUniqueID, Parent, PreviousSibling, MetadataIndex ? *MetadataIndex : INDEX_NONE);
+
+		int32 NumGeometries;
+		Deserializer << NumGeometries;
+
+		for (int32 i = 0; i < NumGeometries && !Deserializer.IsError(); i++)
+		{
+			int64 GUniqueID;
+			Deserializer << GUniqueID;
+			const int32* GeometryIndex = GeometryIDToIndex.Find(GUniqueID);
 
-	int32 NumGeometries;
-	Deserializer << NumGeometries;
-	NewHNode->Geometries.SetNum/*Uninitialized-crashes*/(NumGeometries);
+			FTransform Transform;
+			Deserializer << Transform;
 
-	for (int32 i = 0; i < NumGeometries; i++)
+			FColor Color;
+			Deserializer << Color;
+
+			AddPart(GeometryIndex ? *GeometryIndex : INDEX_NONE, Transform, Color);
+		}
+
+		int32 NumChildren;
+		Deserializer << NumChildren;
+
+		if (Deserializer.IsError())
+		{
+			ResetHierarchy();
+			return;
+		}
+
+		if (OpenNodes.Num() > 0)
+		{
+			OpenNodes.Last().LastChild = Index;
+			OpenNodes.Last().RemainingChildren--;
+		}
+		if (NumChildren > 0)
+		{
+			OpenNodes.Add({ Index, NumChildren, INDEX_NONE });
+		}
+		while (OpenNodes.Num() > 0 && OpenNodes.Last().RemainingChildren == 0)
+		{
+			OpenNodes.Pop(false);
+		}
+	} while (OpenNodes.Num() > 0);
+
+	SortHierarchyBreadthFirst();
+}
+
+void BFinalAssetContent::XDeserialize_Hierarchy(FArchive& Deserializer, const TMap<int64, int32>& GeometryIDToIndex, const TMap<int64, int32>& MetadataIDToIndex)
+{
+	int32 NumNodes;
+	int32 NumParts;
+	Deserializer << NumNodes;
+	Deserializer << NumParts;
+	if (Deserializer.IsError() || NumNodes < 0 || NumParts < 0) return;
+
+	//Corrupt counts must not allocate; the columns have to fit in what is left of the payload.
+	const int64 ColumnBytes = NumNodes * (int64)X_BULK_HIERARCHY_NODE_BYTES + NumParts * (int64)X_BULK_HIERARCHY_PART_BYTES;
+	if (ColumnBytes > Deserializer.TotalSize() - Deserializer.Tell()) return;
+
+	TArray<int64> NodeMetadataIDs;
+	TArray<int64> PartGeometryIDs;
+	TArray<FQuat> PartRotations;
+	TArray<FVector> PartTranslations;
+	TArray<FVector> PartScales;
+
+	LoadBulk(Deserializer, HierarchyIDs, NumNodes);
+	LoadBulk(Deserializer, HierarchyParents, NumNodes);
+	LoadBulk(Deserializer, NodeMetadataIDs, NumNodes);
+	LoadBulk(Deserializer, HierarchyPartCounts, NumNodes);
+
+	LoadBulk(Deserializer, PartGeometryIDs, NumParts);
+	LoadBulk(Deserializer, PartRotations, NumParts);
+	LoadBulk(Deserializer, PartTranslations, NumParts);
+	LoadBulk(Deserializer, PartScales, NumParts);
+	LoadBulk(Deserializer, PartColors, NumParts);
+
+	//Parents must come first and in non-decreasing order, otherwise children are not contiguous.
+	bool bValid = !Deserializer.IsError() && (NumNodes == 0 || HierarchyParents[0] == INDEX_NONE);
+	int64 PartSum = 0;
+	for (int32 i = 0; bValid && i < NumNodes; i++)
 	{
-		TSharedPtr<BFinalGeometryPart> NewGPart = MakeShareable(new BFinalGeometryPart);
-		NewHNode->Geometries[i] = NewGPart;
+		bValid = (i == 0 || (HierarchyParents[i] >= 0 && HierarchyParents[i] < i && HierarchyParents[i] >= HierarchyParents[i - 1]))
+			&& HierarchyPartCounts[i] >= 0;
+		PartSum += HierarchyPartCounts[i];
+	}
+	if (!bValid || PartSum != NumParts)
+	{
+		ResetHierarchy();
+		PartColors.Reset();
+		return;
+	}
 
-		int64 GUniqueID;
-		Deserializer << GUniqueID;
-		NewGPart->GeometryNode = GeometryIDToNodeMap[GUniqueID];
+	HierarchyMetadata.SetNumUninitialized(NumNodes);
+	HierarchyFirstParts.SetNumUninitialized(NumNodes);
+	int32 FirstPart = 0;
+	for (int32 i = 0; i < NumNodes; i++)
+	{
+		const int32* MetadataIndex = MetadataIDToIndex.Find(NodeMetadataIDs[i]);
+		HierarchyMetadata[i] = MetadataIndex ? *MetadataIndex : INDEX_NONE;
 
-		Deserializer << NewGPart->Transform;
+		HierarchyFirstParts[i] = FirstPart;
+		FirstPart += HierarchyPartCounts[i];
+	}
+	LinkChildren();
+
+	PartGeometries.SetNumUninitialized(NumParts);
+	PartTransforms.SetNumUninitialized(NumParts);
+	PartInstanceIndexes.Init(INDEX_NONE, NumParts);
+	for (int32 i = 0; i < NumParts; i++)
+	{
+		const int32* GeometryIndex = GeometryIDToIndex.Find(PartGeometryIDs[i]);
+		PartGeometries[i] = GeometryIndex ? *GeometryIndex : INDEX_NONE;
+
+		PartTransforms[i] = FTransform(PartRotations[i], PartTranslations[i], PartScales[i]);
+	}
+}
+
+void BFinalAssetContent::LinkChildren()
+{
+	const int32 NumNodes = HierarchyIDs.Num();
+	HierarchyFirstChildren.Init(INDEX_NONE, NumNodes);
+	HierarchyNextSiblings.Init(INDEX_NONE, NumNodes);
+
+	for (int32 i = 1; i < NumNodes; i++)
+	{
+		const int32 Parent = HierarchyParents[i];
+		if (HierarchyFirstChildren[Parent] == INDEX_NONE)
+		{
+			HierarchyFirstChildren[Parent] = i;
+		}
+		if (i + 1 < NumNodes && HierarchyParents[i + 1] == Parent)
+		{
+			HierarchyNextSiblings[i] = i + 1;
+		}
+	}
+}
 
-		Deserializer << NewGPart->Color;
+void BFinalAssetContent::SortHierarchyBreadthFirst()
+{
+	const int32 NumNodes = HierarchyIDs.Num();
+	if (NumNodes == 0) return;
+
+	//Old indexes in breadth-first order; the queue is the output itself.
+	TArray<int32> Order;
+	Order.Reserve(NumNodes);
+	Order.Add(0);
+	for (int32 i = 0; i < Order.Num(); i++)
+	{
+		for (int32 Child = HierarchyFirstChildren[Order[i]]; Child != INDEX_NONE; Child = HierarchyNextSiblings[Child])
+		{
+			Order.Add(Child);
+		}
 	}
 
-	int32 NumChildren;
-	Deserializer << NumChildren;
-	NewHNode->Children.SetNum/*Uninitialized-crashes*/(NumChildren);
+	TArray<int32> NewIndexes;
+	NewIndexes.SetNumUninitialized(NumNodes);
+	for (int32 i = 0; i < Order.Num(); i++)
+	{
+		NewIndexes[Order[i]] = i;
+	}
 
-	for (int32 i = 0; i < NumChildren; i++)
+	BFinalAssetContent Sorted;
+	Sorted.ReserveHierarchyNodes(Order.Num(), PartGeometries.Num());
+	for (int32 i = 0; i < Order.Num(); i++)
 	{
-		NewHNode->Children[i] = XDeserialize_Recursive(Deserializer);
+		const int32 Old = Order[i];
+		const int32 Parent = HierarchyParents[Old] != INDEX_NONE ? NewIndexes[HierarchyParents[Old]] : INDEX_NONE;
+
+		//Siblings stay in their order, so the previous sibling is the previous node whenever it has the same parent.
+		const int32 PreviousSibling = (i > 0 && Sorted.HierarchyParents[i - 1] == Parent) ? i - 1 : INDEX_NONE;
+
+		Sorted.AddHierarchyNode(HierarchyIDs[Old], Parent, PreviousSibling, HierarchyMetadata[Old]);
+
+		const int32 FirstPart = HierarchyFirstParts[Old];
+		for (int32 Part = FirstPart; Part < FirstPart + HierarchyPartCounts[Old]; Part++)
+		{
+			Sorted.AddPart(PartGeometries[Part], PartTransforms[Part], PartColors[Part]);
+		}
 	}
 
-	return NewHNode;
+	HierarchyIDs = MoveTemp(Sorted.HierarchyIDs);
+	HierarchyParents = MoveTemp(Sorted.HierarchyParents);
+	HierarchyFirstChildren = MoveTemp(Sorted.HierarchyFirstChildren);
+	HierarchyNextSiblings = MoveTemp(Sorted.HierarchyNextSiblings);
+	HierarchyMetadata = MoveTemp(Sorted.HierarchyMetadata);
+	HierarchyFirstParts = MoveTemp(Sorted.HierarchyFirstParts);
+	HierarchyPartCounts = MoveTemp(Sorted.HierarchyPartCounts);
+
+	PartGeometries = MoveTemp(Sorted.PartGeometries);
+	PartTransforms = MoveTemp(Sorted.PartTransforms);
+	PartColors = MoveTemp(Sorted.PartColors);
+	PartInstanceIndexes = MoveTemp(Sorted.PartInstanceIndexes);
+}
+
+void BFinalAssetContent::ResetHierarchy()
+{
+	HierarchyIDs.Reset();
+	HierarchyParents.Reset();
+	HierarchyFirstChildren.Reset();
+	HierarchyNextSiblings.Reset();
+	HierarchyMetadata.Reset();
+	HierarchyFirstParts.Reset();
+	HierarchyPartCounts.Reset();
+
+	PartGeometries.Reset();
+	PartTransforms.Reset();
+	PartColors.Reset();
+	PartInstanceIndexes.Reset();
 }
\ No newline at end of file
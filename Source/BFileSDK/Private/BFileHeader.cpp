@@ -4,11 +4,99 @@
 
 int32 BFileHeader::GetHeaderSize() const
 {
-	return sizeof(FileSDKVersion);
+	return FileSDKVersion >= 2 ? X_HEADER_V2_SIZE : X_HEADER_SIZE;
 }
 
 int32 BFileHeader::ReadHeader(const uint8* InBytes)
 {
 	FMemory::Memcpy(&FileSDKVersion, InBytes, sizeof(FileSDKVersion));
-	return sizeof(FileSDKVersion);
+
+	if (FileSDKVersion >= 2)
+	{
+		const uint8* Head = InBytes + 2 * sizeof(uint32); //Version, magic
+		FMemory::Memcpy(&Flags, Head, sizeof(Flags));
+		Head += sizeof(Flags);
+		FMemory::Memcpy(&NodeCount, Head, sizeof(NodeCount));
+		Head += sizeof(NodeCount);
+		FMemory::Memcpy(&PayloadSize, Head, sizeof(PayloadSize));
+	}
+	else
+	{
+		Flags = EBFileHeaderFlags_None;
+		NodeCount = -1;
+		PayloadSize = -1;
+	}
+	return GetHeaderSize();
+}
+
+void BFileHeader::WriteHeader(uint32 InFlags, int64 InNodeCount, int64 InPayloadSize, TArray<uint8>& OutBytes)
+{
+	const uint32 Version = X_LATEST_FILE_SDK_VERSION;
+	const uint32 Magic = X_HEADER_V2_MAGIC;
+
+	OutBytes.Append((const uint8*)&Version, sizeof(Version));
+	OutBytes.Append((const uint8*)&Magic, sizeof(Magic));
+	OutBytes.Append((const uint8*)&InFlags, sizeof(InFlags));
+	OutBytes.Append((const uint8*)&InNodeCount, sizeof(InNodeCount));
+	OutBytes.Append((const uint8*)&InPayloadSize, sizeof(InPayloadSize));
+}
+
+void BFileHeader::UpdatePayloadSize(TArray<uint8>& InOutStream, int64 InPayloadSize)
+{
+	if (PeekHeaderSize(InOutStream.GetData(), InOutStream.Num()) != X_HEADER_V2_SIZE || InOutStream.Num() < (int32)X_HEADER_V2_SIZE) return;
+
+	FMemory::Memcpy(InOutStream.GetData() + X_HEADER_V2_PAYLOAD_SIZE_OFFSET, &InPayloadSize, sizeof(InPayloadSize));
+}
+
+int32 BFileHeader::PeekHeaderSize(const uint8* InBytes, int32 InSize)
+{
+	if (InSize < (int32)X_HEADER_SIZE) return X_HEADER_SIZE;
+
+	uint32 Version;
+	FMemory::Memcpy(&Version, InBytes, sizeof(Version));
+	if (Version < 2) return X_HEADER_SIZE;
+
+	//Newer versions keep the v2 layout at the beginning; the magic tells a v2+ header apart from garbage.
+	if (InSize >= (int32)(2 * sizeof(uint32)))
+	{
+		uint32 Magic;
+		FMemory::Memcpy(&Magic, InBytes + sizeof(uint32), sizeof(Magic));
+		if (Magic != X_HEADER_V2_MAGIC) return -1;
+	}
+	return X_HEADER_V2_SIZE;
+}
+
+uint32 BFileHeader::PeekFlags(const uint8* InBytes, int32 InSize)
+{
+	if (PeekHeaderSize(InBytes, InSize) != X_HEADER_V2_SIZE || InSize < (int32)(3 * sizeof(uint32))) return EBFileHeaderFlags_None;
+
+	uint32 HeaderFlags;
+	FMemory::Memcpy(&HeaderFlags, InBytes + 2 * sizeof(uint32), sizeof(HeaderFlags));
+	return HeaderFlags;
+}
+
+bool BFileHeader::WriteCompressedStreamHeader(EBFileCompressionCodec InCodec, const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes)
+{
+	const int32 Size = (int32)FMath::Min<int64>(InSize, X_HEADER_V2_SIZE);
+	if (Size < (int32)X_HEADER_V2_SIZE || PeekHeaderSize(InBytes, Size) != X_HEADER_V2_SIZE) return false;
+
+	uint32 HeaderFlags = PeekFlags(InBytes, Size);
+	HeaderFlags = (HeaderFlags & ~EBFileHeaderFlags_CodecMask) | ((uint32)InCodec << X_HEADER_FLAGS_CODEC_SHIFT);
+
+	const int32 FlagsOffset = OutBytes.Num() + 2 * sizeof(uint32); //Version, magic
+	OutBytes.Append(InBytes, X_HEADER_V2_SIZE);
+	FMemory::Memcpy(OutBytes.GetData() + FlagsOffset, &HeaderFlags, sizeof(HeaderFlags));
+	return true;
+}
+
+int32 BFileHeader::PeekCompressedStreamHeader(const uint8* InBytes, int32 InSize, EBFileCompressionCodec& OutCodec)
+{
+	//The version and magic of a v2 header mark the stream; nothing is assumed about how a compressed stream may start.
+	OutCodec = EBFileCompressionCodec_Deflate;
+	const bool bHasMagic = InSize >= (int32)(2 * sizeof(uint32)) && PeekHeaderSize(InBytes, InSize) == X_HEADER_V2_SIZE;
+	if (!bHasMagic) return 0;
+	if (InSize < (int32)X_HEADER_V2_SIZE) return -1;
+
+	OutCodec = (EBFileCompressionCodec)((PeekFlags(InBytes, InSize) & EBFileHeaderFlags_CodecMask) >> X_HEADER_FLAGS_CODEC_SHIFT);
+	return X_HEADER_V2_SIZE;
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileImportTelemetry.h"
+#include "Serialization/JsonWriter.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+
+BFileImportTelemetry::BFileImportTelemetry()
+{
+	StartCycles = FPlatformTime::Cycles64();
+
+	for (int32 i = 0; i < EBImportTimer_MAX; i++)
+	{
+		TimerCycles[i] = 0;
+		TimerCalls[i] = 0;
+	}
+	for (int32 i = 0; i < EBImportCounter_MAX; i++)
+	{
+		Counters[i] = 0;
+	}
+	for (int32 i = 0; i < EBImportGauge_MAX; i++)
+	{
+		GaugeLast[i] = 0;
+		GaugePeak[i] = 0;
+	}
+}
+
+void BFileImportTelemetry::AddTime(EBImportTimer InTimer, uint64 InCycles, int64 InCalls)
+{
+	TimerCycles[InTimer] += InCycles;
+	TimerCalls[InTimer] += InCalls;
+}
+
+void BFileImportTelemetry::Add(EBImportCounter InCounter, int64 InValue)
+{
+	Counters[InCounter] += InValue;
+}
+
+void BFileImportTelemetry::Sample(EBImportGauge InGauge, int64 InValue)
+{
+	GaugeLast[InGauge] = InValue;
+
+	int64 Peak = GaugePeak[InGauge].Load();
+	while (InValue > Peak && !GaugePeak[InGauge].CompareExchange(Peak, InValue)) {}
+}
+
+FString BFileImportTelemetry::ToJson() const
+{
+	FString Result;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Result);
+
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("WallSeconds"), FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles));
+
+	Writer->WriteObjectStart(TEXT("Timers"));
+	for (int32 i = 0; i < EBImportTimer_MAX; i++)
+	{
+		Writer->WriteObjectStart(GetName((EBImportTimer)i));
+		Writer->WriteValue(TEXT("Seconds"), FPlatformTime::ToSeconds64(TimerCycles[i].Load()));
+		Writer->WriteValue(TEXT("Calls"), TimerCalls[i].Load());
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectStart(TEXT("Counters"));
+	for (int32 i = 0; i < EBImportCounter_MAX; i++)
+	{
+		Writer->WriteValue(GetName((EBImportCounter)i), Counters[i].Load());
+	}
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectStart(TEXT("Gauges"));
+	for (int32 i = 0; i < EBImportGauge_MAX; i++)
+	{
+		Writer->WriteObjectStart(GetName((EBImportGauge)i));
+		Writer->WriteValue(TEXT("Last"), GaugeLast[i].Load());
+		Writer->WriteValue(TEXT("Peak"), GaugePeak[i].Load());
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+	return Result;
+}
+
+const TCHAR* BFileImportTelemetry::GetName(EBImportTimer InTimer)
+{
+	switch (InTimer)
+	{
+	case EBImportTimer_Inflate: return TEXT("Inflate");
+	case EBImportTimer_Decode: return TEXT("Decode");
+	case EBImportTimer_HierarchyNodes: return TEXT("HierarchyNodes");
+	case EBImportTimer_MetadataNodes: return TEXT("MetadataNodes");
+	case EBImportTimer_GeometryHash: return TEXT("GeometryHash");
+	case EBImportTimer_RawMeshExpansion: return TEXT("RawMeshExpansion");
+	case EBImportTimer_StaticMeshBuild: return TEXT("StaticMeshBuild");
+	case EBImportTimer_RenderDataSerialization: return TEXT("RenderDataSerialization");
+	case EBImportTimer_Finalize: return TEXT("Finalize");
+	case EBImportTimer_XSerialize: return TEXT("XSerialize");
+	case EBImportTimer_BlockCompression: return TEXT("BlockCompression");
+	default: return TEXT("Unknown");
+	}
+}
+
+const TCHAR* BFileImportTelemetry::GetName(EBImportCounter InCounter)
+{
+	switch (InCounter)
+	{
+	case EBImportCounter_ReaderInputBytes: return TEXT("ReaderInputBytes");
+	case EBImportCounter_DecodedBytes: return TEXT("DecodedBytes");
+	case EBImportCounter_HierarchyNodes: return TEXT("HierarchyNodes");
+	case EBImportCounter_GeometryNodes: return TEXT("GeometryNodes");
+	case EBImportCounter_MetadataNodes: return TEXT("MetadataNodes");
+	case EBImportCounter_DecodeFailures: return TEXT("DecodeFailures");
+	case EBImportCounter_DeduplicatedGeometryNodes: return TEXT("DeduplicatedGeometryNodes");
+	case EBImportCounter_StaticMeshBuildBatches: return TEXT("StaticMeshBuildBatches");
+	case EBImportCounter_NodeBatches: return TEXT("NodeBatches");
+	case EBImportCounter_RenderDataBytes: return TEXT("RenderDataBytes");
+	case EBImportCounter_OutputBytes: return TEXT("OutputBytes");
+	default: return TEXT("Unknown");
+	}
+}
+
+const TCHAR* BFileImportTelemetry::GetName(EBImportGauge InGauge)
+{
+	switch (InGauge)
+	{
+	case EBImportGauge_ReaderBufferedBytes: return TEXT("ReaderBufferedBytes");
+	case EBImportGauge_QueuedNodeBytes: return TEXT("QueuedNodeBytes");
+	case EBImportGauge_ActiveTasks: return TEXT("ActiveTasks");
+	case EBImportGauge_PendingStaticMeshBuilds: return TEXT("PendingStaticMeshBuilds");
+	default: return TEXT("Unknown");
+	}
+}
\ No newline at end of file
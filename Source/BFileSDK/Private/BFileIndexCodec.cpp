@@ -0,0 +1,177 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileIndexCodec.h"
+
+struct FBIndexCodecEdge
+{
+	uint32 A;
+	uint32 B;
+};
+
+//Edges of a triangle are pushed reversed; that is the winding an adjacent triangle shares them in.
+static FORCEINLINE void PushTriangleEdges(FBIndexCodecEdge* EdgeFifo, uint32& EdgeFifoHead, uint32 A, uint32 B, uint32 C)
+{
+	EdgeFifo[EdgeFifoHead++ & (X_INDEX_CODEC_EDGE_FIFO_SIZE - 1)] = { B, A };
+	EdgeFifo[EdgeFifoHead++ & (X_INDEX_CODEC_EDGE_FIFO_SIZE - 1)] = { C, B };
+	EdgeFifo[EdgeFifoHead++ & (X_INDEX_CODEC_EDGE_FIFO_SIZE - 1)] = { A, C };
+}
+
+static FORCEINLINE void WriteDelta(TArray<uint8>& OutBytes, uint32 Value, uint32& Last)
+{
+	const int32 Delta = (int32)(Value - Last);
+	uint32 ZigZag = ((uint32)Delta << 1) ^ (uint32)(Delta >> 31);
+	Last = Value;
+
+	while (ZigZag >= 0x80)
+	{
+		OutBytes.Add((uint8)(ZigZag | 0x80));
+		ZigZag >>= 7;
+	}
+	OutBytes.Add((uint8)ZigZag);
+}
+
+static FORCEINLINE bool ReadDelta(const uint8*& Head, const uint8* End, uint32& Last)
+{
+	uint32 ZigZag = 0;
+	for (int32 Shift = 0; Shift < 35; Shift += 7)
+	{
+		if (Head == End) return false;
+
+		const uint8 Byte = *Head++;
+		ZigZag |= (uint32)(Byte & 0x7F) << Shift;
+		if ((Byte & 0x80) == 0)
+		{
+			Last += (ZigZag >> 1) ^ (0 - (ZigZag & 1));
+			return true;
+		}
+	}
+	return false;
+}
+
+void BFileIndexCodec::Encode(const uint32* InIndexes, int32 IndexCount, TArray<uint8>& OutBytes)
+{
+	check(IndexCount % 3 == 0);
+
+	FBIndexCodecEdge EdgeFifo[X_INDEX_CODEC_EDGE_FIFO_SIZE];
+	FMemory::Memset(EdgeFifo, 0xFF, sizeof(EdgeFifo));
+	uint32 EdgeFifoHead = 0;
+
+	uint32 NextVertex = 0;
+	uint32 Last = 0;
+
+	for (int32 i = 0; i < IndexCount; i += 3)
+	{
+		const uint32 Triangle[3] = { InIndexes[i], InIndexes[i + 1], InIndexes[i + 2] };
+
+		//Newest edges first; slot is the distance from the head
+		int32 Slot = -1;
+		int32 Rotation = 0;
+		for (int32 Distance = 0; Distance < X_INDEX_CODEC_EDGE_FIFO_SIZE && Slot < 0; Distance++)
+		{
+			const FBIndexCodecEdge& Edge = EdgeFifo[(EdgeFifoHead - 1 - Distance) & (X_INDEX_CODEC_EDGE_FIFO_SIZE - 1)];
+			for (int32 r = 0; r < 3; r++)
+			{
+				if (Edge.A == Triangle[r] && Edge.B == Triangle[(r + 1) % 3])
+				{
+					Slot = Distance;
+					Rotation = r;
+					break;
+				}
+			}
+		}
+
+		if (Slot >= 0)
+		{
+			const uint32 Third = Triangle[(Rotation + 2) % 3];
+			if (Third == NextVertex)
+			{
+				OutBytes.Add((uint8)(Slot | (X_INDEX_CODE_EDGE_NEW << 4) | (Rotation << 6)));
+			}
+			else
+			{
+				OutBytes.Add((uint8)(Slot | (X_INDEX_CODE_EDGE_DELTA << 4) | (Rotation << 6)));
+				WriteDelta(OutBytes, Third, Last);
+			}
+		}
+		else
+		{
+			OutBytes.Add((uint8)(X_INDEX_CODE_EXPLICIT << 4));
+			WriteDelta(OutBytes, Triangle[0], Last);
+			WriteDelta(OutBytes, Triangle[1], Last);
+			WriteDelta(OutBytes, Triangle[2], Last);
+		}
+
+		for (int32 r = 0; r < 3; r++)
+		{
+			NextVertex = FMath::Max(NextVertex, Triangle[r] + 1);
+		}
+		PushTriangleEdges(EdgeFifo, EdgeFifoHead, Triangle[0], Triangle[1], Triangle[2]);
+	}
+}
+
+bool BFileIndexCodec::Decode(const uint8* InBytes, int32 InSize, uint32* OutIndexes, int32 IndexCount, int32 VertexCount)
+{
+	if (IndexCount < 0 || IndexCount % 3 != 0 || InSize < 0) return false;
+
+	const uint8* Head = InBytes;
+	const uint8* End = InBytes + InSize;
+
+	FBIndexCodecEdge EdgeFifo[X_INDEX_CODEC_EDGE_FIFO_SIZE];
+	FMemory::Memset(EdgeFifo, 0xFF, sizeof(EdgeFifo));
+	uint32 EdgeFifoHead = 0;
+
+	uint32 NextVertex = 0;
+	uint32 Last = 0;
+
+	for (int32 i = 0; i < IndexCount; i += 3)
+	{
+		if (Head == End) return false;
+		const uint8 Code = *Head++;
+
+		const int32 Mode = (Code >> 4) & 0x3;
+		const int32 Rotation = Code >> 6;
+		uint32 Triangle[3];
+
+		if (Mode == X_INDEX_CODE_EXPLICIT)
+		{
+			if (Rotation != 0 || !ReadDelta(Head, End, Last)) return false;
+			Triangle[0] = Last;
+			if (!ReadDelta(Head, End, Last)) return false;
+			Triangle[1] = Last;
+			if (!ReadDelta(Head, End, Last)) return false;
+			Triangle[2] = Last;
+		}
+		else
+		{
+			if (Rotation > 2 || Mode > X_INDEX_CODE_EDGE_DELTA) return false;
+
+			const FBIndexCodecEdge& Edge = EdgeFifo[(EdgeFifoHead - 1 - (Code & 0xF)) & (X_INDEX_CODEC_EDGE_FIFO_SIZE - 1)];
+
+			uint32 Third = NextVertex;
+			if (Mode == X_INDEX_CODE_EDGE_DELTA)
+			{
+				if (!ReadDelta(Head, End, Last)) return false;
+				Third = Last;
+			}
+
+			Triangle[Rotation] = Edge.A;
+			Triangle[(Rotation + 1) % 3] = Edge.B;
+			Triangle[(Rotation + 2) % 3] = Third;
+		}
+
+		//Also rejects FIFO slots that were never filled
+		if (Triangle[0] >= (uint32)VertexCount || Triangle[1] >= (uint32)VertexCount || Triangle[2] >= (uint32)VertexCount) return false;
+
+		OutIndexes[i] = Triangle[0];
+		OutIndexes[i + 1] = Triangle[1];
+		OutIndexes[i + 2] = Triangle[2];
+
+		for (int32 r = 0; r < 3; r++)
+		{
+			NextVertex = FMath::Max(NextVertex, Triangle[r] + 1);
+		}
+		PushTriangleEdges(EdgeFifo, EdgeFifoHead, Triangle[0], Triangle[1], Triangle[2]);
+	}
+
+	return Head == End;
+}
\ No newline at end of file
@@ -1,6 +1,8 @@
 /// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
 
 #include "BFileMeshSerialization.h"
+#include "BFileCommonTypes.h"
+#include "BFileTangentBasis.h"
 #include "Serialization/MemoryWriter.h"
 #include "Serialization/MemoryReader.h"
 #include "MeshUtilities.h"
@@ -100,6 +102,126 @@ void BFileMeshSerialization::SerializeStaticMesh(UStaticMesh* StaticMesh, TArray
 	Serializer << StaticMesh->RenderData->Bounds;
 }
 
+void BFileMeshSerialization::SerializeGeometryNode(const BGeometryNode& InNode, TArray<uint8>& DestBuffer)
+{
+	auto Serializer = FMemoryWriter(DestBuffer);
+
+	int32 LODCount = FMath::Min(InNode.LODs.Num(), (int32)MAX_STATIC_MESH_LODS);
+	Serializer << LODCount;
+
+	TArray<FVector> BoundsPositions;
+
+	for (int32 i = 0; i < LODCount; i++)
+	{
+		auto& LOD = InNode.LODs[i];
+		const int32 VertexCount = LOD.GetVertexCount();
+
+		//Sections part
+		int32 SectionsCount = 1;
+		Serializer << SectionsCount;
+		{
+			uint32 MinIndex = VertexCount > 0 ? (uint32)(VertexCount - 1) : 0;
+			uint32 MaxIndex = 0;
+			for (uint32 Index : LOD.Indexes)
+			{
+				MinIndex = FMath::Min(MinIndex, Index);
+				MaxIndex = FMath::Max(MaxIndex, Index);
+			}
+			if (LOD.Indexes.Num() == 0) MinIndex = 0;
+
+			int32 FirstIndex = 0;
+			Serializer << FirstIndex;
+
+			int32 MaxVertexIndex = (int32)MaxIndex;
+			Serializer << MaxVertexIndex;
+
+			int32 MinVertexIndex = (int32)MinIndex;
+			Serializer << MinVertexIndex;
+
+			int32 NumTriangles = LOD.Indexes.Num() / 3;
+			Serializer << NumTriangles;
+		}
+
+		//Vertex data in render formats: FVector positions, [TangentX, TangentZ] FPackedNormal pairs, one FVector2DHalf texcoord
+		TArray<uint8> PositionData;
+		TArray<uint8> TangentData;
+		TArray<uint8> TexcoordData;
+		PositionData.SetNumUninitialized(VertexCount * sizeof(FVector));
+		TangentData.SetNumUninitialized(VertexCount * 2 * sizeof(FPackedNormal));
+		TexcoordData.SetNumZeroed(VertexCount * sizeof(FVector2DHalf));
+
+		FVector* Positions = (FVector*)PositionData.GetData();
+		FPackedNormal* Tangents = (FPackedNormal*)TangentData.GetData();
+		if (LOD.bPackedVertices)
+		{
+			FMemory::Memcpy(Positions, LOD.Positions.GetData(), VertexCount * sizeof(FVector));
+			for (int32 j = 0; j < VertexCount; j++)
+			{
+				Tangents[2 * j] = LOD.TangentX[j];
+				Tangents[2 * j + 1] = LOD.TangentZ[j];
+			}
+		}
+		else
+		{
+			TArray<FVector> TangentX, TangentY, TangentZ;
+			BFileTangentBasis::Compute(LOD, TangentX, TangentY, TangentZ);
+
+			for (int32 j = 0; j < VertexCount; j++)
+			{
+				auto& Vertex = LOD.VertexNormalTangentList[j].Vertex;
+				Positions[j] = FVector(Vertex.X, Vertex.Y, Vertex.Z);
+
+				//Bitangent is Normal x Tangent, as the engine build gets it; that makes the basis determinant sign +1.
+				Tangents[2 * j] = FPackedNormal(TangentX[j]);
+				Tangents[2 * j + 1] = FPackedNormal(FVector4(TangentZ[j], 1.0f));
+			}
+		}
+
+		if (i == 0)
+		{
+			BoundsPositions.Append(Positions, VertexCount);
+		}
+
+		//BuffersSize part
+		uint32 BuffersSize = PositionData.Num() + TangentData.Num() + TexcoordData.Num() + LOD.Indexes.Num() * sizeof(uint32);
+		Serializer << BuffersSize;
+
+		//PositionVertexBuffer part
+		uint32 PositionVertexBuffer_NumVertices = VertexCount;
+		Serializer << PositionVertexBuffer_NumVertices;
+		Serializer << PositionData;
+
+		//StaticMeshVertexBuffer part
+		uint32 StaticMeshVertexBuffer_TangentSize = TangentData.Num();
+		Serializer << StaticMeshVertexBuffer_TangentSize;
+		Serializer << TangentData;
+
+		uint32 StaticMeshVertexBuffer_TexCoordSize = TexcoordData.Num();
+		Serializer << StaticMeshVertexBuffer_TexCoordSize;
+		Serializer << TexcoordData;
+
+		//IndexBuffer part
+		Serializer << const_cast<TArray<uint32>&>(LOD.Indexes);
+	}
+
+	//Same as the engine build: box of LOD0, sphere around the box center
+	FBox BoundingBox(BoundsPositions.GetData(), BoundsPositions.Num());
+	FBoxSphereBounds Bounds(FVector::ZeroVector, FVector::ZeroVector, 0.0f);
+	if (BoundingBox.IsValid)
+	{
+		Bounds.Origin = BoundingBox.GetCenter();
+		Bounds.BoxExtent = BoundingBox.GetExtent();
+
+		float RadiusSquared = 0.0f;
+		for (const FVector& Position : BoundsPositions)
+		{
+			RadiusSquared = FMath::Max(RadiusSquared, (Position - Bounds.Origin).SizeSquared());
+		}
+		Bounds.SphereRadius = FMath::Sqrt(RadiusSquared);
+	}
+	Serializer << Bounds;
+}
+
 void BFileMeshSerialization::DeserializeToRenderData(const TArray<uint8>& SrcBuffer, FStaticMeshRenderData* RenderData)
 {
 	
@@ -0,0 +1,152 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileNodeIndex.h"
+#include "BFileHeader.h"
+
+bool BFileNodeIndex::IsIndexAt(const uint8* InHead, int32 AvailableBytes)
+{
+	if (AvailableBytes < (int32)sizeof(uint64)) return false;
+
+	uint64 MarkerID;
+	FMemory::Memcpy(&MarkerID, InHead, sizeof(uint64));
+	return MarkerID == X_NODE_INDEX_MARKER_ID;
+}
+
+EBNodeFramingResult BFileNodeIndex::Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes)
+{
+	const int64 EntryCountOffset = sizeof(uint64);
+	if (AvailableBytes < EntryCountOffset + (int64)sizeof(int32))
+	{
+		NodeSize = EntryCountOffset + sizeof(int32);
+		return EBNodeFramingResult_NeedMoreData;
+	}
+
+	int32 EntryCount;
+	FMemory::Memcpy(&EntryCount, InHead + EntryCountOffset, sizeof(int32));
+	if (EntryCount < 0) return EBNodeFramingResult_Invalid;
+
+	int64 Size = EntryCountOffset + sizeof(int32) + (int64)EntryCount * X_NODE_INDEX_ENTRY_SIZE + X_NODE_INDEX_TRAILER_SIZE;
+	if (Size > MAX_int32) return EBNodeFramingResult_Invalid;
+
+	NodeSize = (uint32)Size;
+	return Size <= AvailableBytes ? EBNodeFramingResult_Complete : EBNodeFramingResult_NeedMoreData;
+}
+
+bool BFileNodeIndex::AppendToStream(EBNodeType InFileType, TArray<uint8>& InOutStream)
+{
+	const int32 HeaderSize = BFileHeader::PeekHeaderSize(InOutStream.GetData(), InOutStream.Num());
+	if (HeaderSize < 0 || InOutStream.Num() < HeaderSize) return false;
+	const uint32 HeaderFlags = BFileHeader::PeekFlags(InOutStream.GetData(), InOutStream.Num());
+
+	struct BIndexedNode
+	{
+		uint64 UniqueID;
+		int64 Offset;
+		uint32 Size;
+	};
+	TArray<BIndexedNode> Nodes;
+
+	int64 Offset = HeaderSize;
+	while (Offset < InOutStream.Num())
+	{
+		const uint8* Head = InOutStream.GetData() + Offset;
+		const int32 AvailableBytes = InOutStream.Num() - (int32)Offset;
+
+		if (IsIndexAt(Head, AvailableBytes)) return false;
+
+		uint32 NodeSize;
+		EBNodeFramingResult FramingResult;
+		switch (InFileType)
+		{
+		case EBNodeType::EBNodeType_Hierarchy:
+			FramingResult = BHierarchyNode::Frame(NodeSize, Head, AvailableBytes, HeaderFlags);
+			break;
+		case EBNodeType::EBNodeType_Geometry:
+			FramingResult = BGeometryNode::Frame(NodeSize, Head, AvailableBytes, HeaderFlags);
+			break;
+		default:
+			FramingResult = BMetadataNode::Frame(NodeSize, Head, AvailableBytes, HeaderFlags);
+			break;
+		}
+		if (FramingResult != EBNodeFramingResult_Complete) return false;
+
+		BIndexedNode& Node = Nodes.AddDefaulted_GetRef();
+		FMemory::Memcpy(&Node.UniqueID, Head, sizeof(uint64));
+		Node.Offset = Offset;
+		Node.Size = NodeSize;
+
+		Offset += NodeSize;
+	}
+
+	const int64 IndexOffset = Offset;
+	const uint64 MarkerID = X_NODE_INDEX_MARKER_ID;
+	const int32 EntryCount = Nodes.Num();
+	const uint64 TrailerMagic = X_NODE_INDEX_TRAILER_MAGIC;
+
+	InOutStream.Reserve(InOutStream.Num() + sizeof(uint64) + sizeof(int32) + EntryCount * X_NODE_INDEX_ENTRY_SIZE + X_NODE_INDEX_TRAILER_SIZE);
+
+	InOutStream.Append((const uint8*)&MarkerID, sizeof(uint64));
+	InOutStream.Append((const uint8*)&EntryCount, sizeof(int32));
+	for (const BIndexedNode& Node : Nodes)
+	{
+		InOutStream.Append((const uint8*)&Node.UniqueID, sizeof(uint64));
+		InOutStream.Append((const uint8*)&Node.Offset, sizeof(int64));
+		InOutStream.Append((const uint8*)&Node.Size, sizeof(uint32));
+	}
+	InOutStream.Append((const uint8*)&IndexOffset, sizeof(int64));
+	InOutStream.Append((const uint8*)&TrailerMagic, sizeof(uint64));
+
+	BFileHeader::UpdatePayloadSize(InOutStream, InOutStream.Num() - HeaderSize);
+	return true;
+}
+
+bool BFileNodeIndex::FromStream(const uint8* InBytes, int64 InSize)
+{
+	Entries.Reset();
+
+	if (InSize < (int64)(X_HEADER_SIZE + X_NODE_INDEX_TRAILER_SIZE)) return false;
+
+	const uint8* Trailer = InBytes + InSize - X_NODE_INDEX_TRAILER_SIZE;
+
+	uint64 TrailerMagic;
+	FMemory::Memcpy(&TrailerMagic, Trailer + sizeof(int64), sizeof(uint64));
+	if (TrailerMagic != X_NODE_INDEX_TRAILER_MAGIC) return false;
+
+	int64 IndexOffset;
+	FMemory::Memcpy(&IndexOffset, Trailer, sizeof(int64));
+	if (IndexOffset < (int64)X_HEADER_SIZE || IndexOffset >= InSize) return false;
+
+	const uint8* Head = InBytes + IndexOffset;
+	const int64 IndexSize = InSize - IndexOffset;
+
+	uint32 FramedSize;
+	if (!IsIndexAt(Head, (int32)FMath::Min<int64>(IndexSize, MAX_int32))
+		|| Frame(FramedSize, Head, (int32)FMath::Min<int64>(IndexSize, MAX_int32)) != EBNodeFramingResult_Complete
+		|| FramedSize != IndexSize)
+	{
+		return false;
+	}
+
+	int32 EntryCount;
+	FMemory::Memcpy(&EntryCount, Head + sizeof(uint64), sizeof(int32));
+	Head += sizeof(uint64) + sizeof(int32);
+
+	Entries.Reserve(EntryCount);
+	for (int32 i = 0; i < EntryCount; i++)
+	{
+		uint64 UniqueID;
+		BEntry Entry;
+		FMemory::Memcpy(&UniqueID, Head, sizeof(uint64));
+		FMemory::Memcpy(&Entry.Offset, Head + sizeof(uint64), sizeof(int64));
+		FMemory::Memcpy(&Entry.Size, Head + sizeof(uint64) + sizeof(int64), sizeof(uint32));
+		Head += X_NODE_INDEX_ENTRY_SIZE;
+
+		if (Entry.Offset < (int64)X_HEADER_SIZE || Entry.Offset + Entry.Size > IndexOffset)
+		{
+			Entries.Reset();
+			return false;
+		}
+		Entries.Add(UniqueID, Entry);
+	}
+	return true;
+}
\ No newline at end of file
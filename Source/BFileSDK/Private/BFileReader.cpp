@@ -1,28 +1,59 @@
 /// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
 
 #include "BFileReader.h"
-#include "BInflateDeflate.h"
+#include "BFileCodec.h"
+#include "BFileNodeIndex.h"
+#include "BFileStreams.h"
 #include "BLambdaRunnable.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
 #include <stdexcept>
+#include <fstream>
 
 #define UNCOMPRESSED_READ_CHUNK_SIZE 8192
+#define READ_FROM_BYTES_DECODE_BATCH_SIZE (16 * 1024 * 1024)
+
+BFileReader::BFileReader(EBNodeType InFileType, int32 InUnprocessedDataCapacity)
+	: HierarchyNodePool(TBFileNodePool<BHierarchyNode>::Create())
+	, GeometryNodePool(TBFileNodePool<BGeometryNode>::Create())
+	, MetadataNodePool(TBFileNodePool<BMetadataNode>::Create())
+	, UnprocessedDataRing(InUnprocessedDataCapacity)
+{
+	FileType = InFileType;
+
+	//Task graph workers plus the calling thread; ParallelFor runs on both.
+	DecodeWorkerCount = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+
+	ReadChunkSize = UNCOMPRESSED_READ_CHUNK_SIZE;
+
+	ProcessedPayloadBytes = 0;
+	ProcessedNodeCount = 0;
+}
+
+void BFileReader::SetDecodeWorkerCount(int32 InWorkerCount)
+{
+	DecodeWorkerCount = FMath::Max(1, InWorkerCount);
+}
+
+void BFileReader::SetReadChunkSize(int32 InChunkSize)
+{
+	ReadChunkSize = FMath::Max(1, InChunkSize);
+}
 
 void BFileReader::ReadFromStream(
 	std::istream* InStream, 
 	EBFileCompressionState InCompressionState, 
 	TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
-	TFunction<void(const BHierarchyNode&)> OnHierarchyNodeRead_Callback,
-	TFunction<void(const BGeometryNode&)> OnGeometryNodeRead_Callback,
-	TFunction<void(const BMetadataNode&)> OnMetadataNodeRead_Callback,
+	TFunction<void(TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+	TFunction<void(TSharedPtr<BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+	TFunction<void(TSharedPtr<BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
 	TFunction<void(int32, const FString&)> OnErrorAction)
 {
-	OnFileSDKVersionRead = OnFileSDKVersionRead_Callback;
-
-	OnHierarchyNodeRead = OnHierarchyNodeRead_Callback;
-	OnGeometryNodeRead = OnGeometryNodeRead_Callback;
-	OnMetadataNodeRead = OnMetadataNodeRead_Callback;
+	SetCallbacks(OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
 
-	OnError = OnErrorAction;
+	PeakBufferedBytes = 0;
 
 	ThreadOperationCompleted = FGenericPlatformProcess::GetSynchEventFromPool();
 	FBLambdaRunnable::RunLambdaOnDedicatedBackgroundThread([this]()
@@ -32,198 +63,592 @@ void BFileReader::ReadFromStream(
 
 	if (InCompressionState == EBFileCompressionState::Compressed)
 	{
-		BInflateDeflate::DecompressBytes(InStream, 
-			[this](uint8* Buffer, int32 Size)
+		uint8 Header[X_HEADER_V2_SIZE];
+		int32 HeaderRead = (int32)InStream->read((char*)Header, X_HEADER_V2_SIZE).gcount();
+		int32 HeaderSize = ReadCompressedStreamHeader(Header, HeaderRead);
+
+		if (HeaderSize < 0)
+		{
+			bInvalidHeader = true;
+			OnError(400, TEXT("Input is smaller than the file header."));
+		}
+		else
+		{
+			//An uncompressed header is parsed like the decompressed data after it; for streams that are deflate as a whole, the read bytes belong to the compressed data.
+			if (HeaderSize > 0)
 			{
-				ReadChunk_Internal(Buffer, Size);
-			},
-			[OnErrorAction](const FString& ErrorMessage)
+				ReadChunk_Internal(Header, HeaderSize);
+			}
+			BFilePrefixedInputStream CodecStream(Header + HeaderSize, HeaderRead - HeaderSize, InStream);
+
+			ReadChunkCycles = 0;
+			const uint64 DecompressStartCycles = Telemetry ? FPlatformTime::Cycles64() : 0;
+
+			BFileCodec::Decompress(CompressionCodec, &CodecStream,
+				[this](uint8* Buffer, int32 Size)
+				{
+					ReadChunk_Internal(Buffer, Size);
+				},
+				[OnErrorAction](const FString& ErrorMessage)
+				{
+					OnErrorAction(500, ErrorMessage);
+				});
+
+			if (Telemetry)
 			{
-				OnErrorAction(500, ErrorMessage);
-			});
+				//Blocking on a full ring is the parser's cost, not the codec's.
+				Telemetry->AddTime(EBImportTimer_Inflate, FPlatformTime::Cycles64() - DecompressStartCycles - ReadChunkCycles);
+			}
+		}
 	}
 	else
 	{
-		uint8 In[UNCOMPRESSED_READ_CHUNK_SIZE];
+		TArray<uint8> In;
+		In.SetNumUninitialized(ReadChunkSize);
 
-		while (InStream->read((char*)In, UNCOMPRESSED_READ_CHUNK_SIZE).gcount() > 0)
+		while (InStream->read((char*)In.GetData(), ReadChunkSize).gcount() > 0)
 		{
-			ReadChunk_Internal(In, InStream->gcount());
+			ReadChunk_Internal(In.GetData(), InStream->gcount());
 		}
 	}
 
-	bInnerStreamReadCompleted = true;
+	//A stream that ends within the header is truncated, not empty.
+	if (!bHeaderRead && !bInvalidHeader && WaitingHeaderBytes_Num > 0)
+	{
+		bInvalidHeader = true;
+		OnError(400, TEXT("Input is smaller than the file header."));
+	}
+
+	UnprocessedDataRing.MarkWriterCompleted();
 	ThreadOperationCompleted->Wait();
 	FGenericPlatformProcess::ReturnSynchEventToPool(ThreadOperationCompleted);
 }
 
-void BFileReader::ReadChunk_Internal(uint8* Chunk, int32 Size)
+void BFileReader::ReadFromFile(
+	const FString& InFilePath,
+	EBFileCompressionState InCompressionState,
+	TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+	TFunction<void(TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+	TFunction<void(TSharedPtr<BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+	TFunction<void(TSharedPtr<BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+	TFunction<void(int32, const FString&)> OnErrorAction)
 {
-	if (!bHeaderRead)
+	if (InCompressionState == EBFileCompressionState::Uncompressed)
 	{
-		if ((WaitingDataBlockQueue_Header_TotalSize + Size) >= X_HEADER_SIZE)
+		TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*InFilePath));
+		if (MappedFile.IsValid())
 		{
-			TArray<uint8> CurrentBlock;
-			CurrentBlock.SetNumUninitialized(WaitingDataBlockQueue_Header_TotalSize > 0 ? (WaitingDataBlockQueue_Header_TotalSize + Size) : Size);
-
-			TArray<uint8> WaitingBlock;
-			int32 CurrentIx = 0;
-			while (WaitingDataBlockQueue_Header.Dequeue(WaitingBlock))
+			TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile->MapRegion(0, MappedFile->GetFileSize(), true/*bPreloadHint*/));
+			if (MappedRegion.IsValid())
 			{
-				for (int32 i = 0; i < WaitingBlock.Num(); i++)
-					CurrentBlock[CurrentIx++] = WaitingBlock[i];
-
-				WaitingDataBlockQueue_Header_TotalSize -= WaitingBlock.Num();
+				ReadFromBytes(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(),
+					OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
+				return;
 			}
-			for (int32 i = 0; i < Size; i++)
-				CurrentBlock[CurrentIx++] = Chunk[i];
+		}
+	}
 
-			ReadHeader(CurrentBlock.GetData());
-			OnFileSDKVersionRead(FileSDKVersion);
+	std::ifstream FileStream(TCHAR_TO_UTF8(*InFilePath), std::ios::in | std::ios::binary);
+	if (!FileStream.is_open())
+	{
+		OnErrorAction(404, FString::Printf(TEXT("File could not be opened: %s"), *InFilePath));
+		return;
+	}
 
-			if (CurrentBlock.Num() > X_HEADER_SIZE)
-			{
-				int32 Count = CurrentBlock.Num() - X_HEADER_SIZE;
-				
-				TArray<uint8> Rest;
-				Rest.SetNumUninitialized(Count);
-				for (int32 i = 0; i < Count; i++)
-					Rest[i] = CurrentBlock[X_HEADER_SIZE + i];
+	ReadFromStream(&FileStream, InCompressionState,
+		OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
+}
 
-				{
-					FScopeLock ScopeLock(&UnprocessedDataMutex);
-					UnprocessedDataQueue.Enqueue(Rest);
-					UnprocessedDataSize += Rest.Num();
-				}
+void BFileReader::ReadFromBytes(
+	const uint8* InBytes,
+	int64 InSize,
+	TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+	TFunction<void(TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+	TFunction<void(TSharedPtr<BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+	TFunction<void(TSharedPtr<BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+	TFunction<void(int32, const FString&)> OnErrorAction)
+{
+	SetCallbacks(OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
+
+	int32 HeaderSize;
+	if (!ReadHeaderFromBytes(InBytes, InSize, HeaderSize)) return;
+
+	const uint8* Head = InBytes + HeaderSize;
+	int64 Remaining = InSize - HeaderSize;
+
+	if (Telemetry)
+	{
+		Telemetry->Add(EBImportCounter_ReaderInputBytes, Remaining);
+	}
+
+	//No intermediate buffers; nodes are framed and decoded where they lie, one batch at a time.
+	FramedNodes.Reset();
+	int64 FramedBatchBytes = 0;
+
+	while (Remaining > 0)
+	{
+		uint32 NodeSize;
+		bool bDecode;
+		EBNodeFramingResult FramingResult = FrameNode(NodeSize, bDecode, Head, (int32)FMath::Min<int64>(Remaining, MAX_int32));
+
+		if (FramingResult != EBNodeFramingResult_Complete)
+		{
+			DecodeFramedNodes(InBytes);
+			OnError(400, FString::Printf(TEXT("%s at input offset %lld"),
+				FramingResult == EBNodeFramingResult_NeedMoreData ? TEXT("Truncated node") : TEXT("Invalid node framing"),
+				(int64)(Head - InBytes)));
+			return;
+		}
+
+		if (bDecode)
+		{
+			FramedNodes.Add(BNodeExtent{ (int64)(Head - InBytes), NodeSize });
+			FramedBatchBytes += NodeSize;
+		}
+
+		Head += NodeSize;
+		ProcessedPayloadBytes += NodeSize;
+		Remaining -= NodeSize;
+
+		if (FramedBatchBytes >= READ_FROM_BYTES_DECODE_BATCH_SIZE)
+		{
+			DecodeFramedNodes(InBytes);
+			FramedBatchBytes = 0;
+		}
+	}
+
+	DecodeFramedNodes(InBytes);
+}
+
+void BFileReader::ReadNodesFromFile(
+	const FString& InFilePath,
+	EBFileCompressionState InCompressionState,
+	const TArray<uint64>& InUniqueIDs,
+	TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+	TFunction<void(TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+	TFunction<void(TSharedPtr<BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+	TFunction<void(TSharedPtr<BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+	TFunction<void(int32, const FString&)> OnErrorAction)
+{
+	if (InCompressionState == EBFileCompressionState::Uncompressed)
+	{
+		TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*InFilePath));
+		if (MappedFile.IsValid())
+		{
+			//No preload hint; only the trailer, the index and the requested nodes are paged in.
+			TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+			if (MappedRegion.IsValid())
+			{
+				ReadNodesFromBytes(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(), InUniqueIDs,
+					OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
+				return;
 			}
+		}
+	}
+
+	//Compressed streams can not be accessed randomly; skip decoding of the other nodes instead.
+	BeginNodeIDFilter(InUniqueIDs);
+	ReadFromFile(InFilePath, InCompressionState,
+		OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
+	EndNodeIDFilter();
+}
+
+void BFileReader::ReadNodesFromBytes(
+	const uint8* InBytes,
+	int64 InSize,
+	const TArray<uint64>& InUniqueIDs,
+	TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+	TFunction<void(TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+	TFunction<void(TSharedPtr<BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+	TFunction<void(TSharedPtr<BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+	TFunction<void(int32, const FString&)> OnErrorAction)
+{
+	BFileNodeIndex NodeIndex;
+	if (!NodeIndex.FromStream(InBytes, InSize))
+	{
+		BeginNodeIDFilter(InUniqueIDs);
+		ReadFromBytes(InBytes, InSize,
+			OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
+		EndNodeIDFilter();
+		return;
+	}
 
-			bHeaderRead = true;
+	SetCallbacks(OnFileSDKVersionRead_Callback, OnHierarchyNodeRead_Callback, OnGeometryNodeRead_Callback, OnMetadataNodeRead_Callback, OnErrorAction);
+
+	int32 HeaderSize;
+	if (!ReadHeaderFromBytes(InBytes, InSize, HeaderSize)) return;
+
+	FramedNodes.Reset();
+	for (uint64 UniqueID : InUniqueIDs)
+	{
+		if (const BFileNodeIndex::BEntry* Entry = NodeIndex.Find(UniqueID))
+		{
+			FramedNodes.Add(BNodeExtent{ Entry->Offset, Entry->Size });
 		}
 		else
 		{
-			WaitingDataBlockQueue_Header.Enqueue(TArray<uint8>(Chunk, Size));
-			WaitingDataBlockQueue_Header_TotalSize += Size;
+			OnError(404, FString::Printf(TEXT("Node %llu is not in the file"), UniqueID));
 		}
 	}
-	else
+
+	//Stream order keeps page faults sequential.
+	FramedNodes.Sort([](const BNodeExtent& A, const BNodeExtent& B) { return A.Offset < B.Offset; });
+
+	DecodeFramedNodes(InBytes);
+}
+
+void BFileReader::BeginNodeIDFilter(const TArray<uint64>& InUniqueIDs)
+{
+	bFilterNodeIDs = true;
+	NodeIDFilter.Reset();
+	NodeIDFilter.Append(InUniqueIDs);
+}
+
+void BFileReader::EndNodeIDFilter()
+{
+	for (uint64 UniqueID : NodeIDFilter)
 	{
-		FScopeLock ScopeLock(&UnprocessedDataMutex);
-		UnprocessedDataQueue.Enqueue(TArray<uint8>(Chunk, Size));
-		UnprocessedDataSize += Size;
+		OnError(404, FString::Printf(TEXT("Node %llu is not in the file"), UniqueID));
 	}
+	bFilterNodeIDs = false;
+	NodeIDFilter.Reset();
 }
 
-bool BFileReader::SafePeek_UnprocessedDataQueue(TArray<uint8>& Result)
+bool BFileReader::ReadHeaderFromBytes(const uint8* InBytes, int64 InSize, int32& OutHeaderSize)
 {
-	FScopeLock ScopeLock(&UnprocessedDataMutex);
-	return UnprocessedDataQueue.Peek(Result);
+	OutHeaderSize = PeekHeaderSize(InBytes, (int32)FMath::Min<int64>(InSize, X_MAX_HEADER_SIZE));
+	if (OutHeaderSize < 0 || InSize < OutHeaderSize)
+	{
+		OnError(400, OutHeaderSize < 0 ? TEXT("Invalid file header.") : TEXT("Input is smaller than the file header."));
+		return false;
+	}
+
+	ReadHeader(InBytes);
+	OnHeaderRead_Internal();
+	return true;
 }
 
-void BFileReader::Process_Internal()
+void BFileReader::OnHeaderRead_Internal()
 {
-	TArray<uint8> FailedLeftOverBlock;
+	bHeaderRead = true;
 
-	while (true)
+	OnFileSDKVersionRead(FileSDKVersion);
+	if (OnHeaderRead)
 	{
-		int ProcessedBufferCount = 0;
+		OnHeaderRead(*this);
+	}
+}
 
-		int32 UnprocessedDataSize_Current = UnprocessedDataSize;
-		if (UnprocessedDataSize_Current > 0)
-		{
-			TArray<uint8> CurrentBuffer;
-			CurrentBuffer.SetNumUninitialized(FailedLeftOverBlock.Num() + UnprocessedDataSize_Current);
-			
-			for (int32 i = 0; i < FailedLeftOverBlock.Num(); i++)
-				CurrentBuffer[i] = FailedLeftOverBlock[i];
+void BFileReader::SetHeaderReadCallback(TFunction<void(const BFileHeader&)> InOnHeaderRead)
+{
+	OnHeaderRead = InOnHeaderRead;
+}
 
-			int CurrentIndex = FailedLeftOverBlock.Num();
-			FailedLeftOverBlock.Empty();
+void BFileReader::SetProgressCallback(TFunction<void(float)> InOnProgress)
+{
+	OnProgress = InOnProgress;
+}
 
-			TArray<uint8> CurrentBlock;
-			while (SafePeek_UnprocessedDataQueue(CurrentBlock) && CurrentIndex < CurrentBuffer.Num())
-			{
-				for (int32 i = 0; i < CurrentBlock.Num(); i++)
-					CurrentBuffer[i + CurrentIndex] = CurrentBlock[i];
+float BFileReader::GetProgress() const
+{
+	if (PayloadSize > 0)
+	{
+		return FMath::Clamp((float)((double)ProcessedPayloadBytes.Load() / PayloadSize), 0.0f, 1.0f);
+	}
+	if (NodeCount > 0)
+	{
+		return FMath::Clamp((float)((double)ProcessedNodeCount.Load() / NodeCount), 0.0f, 1.0f);
+	}
+	return -1.0f;
+}
 
-				CurrentIndex += CurrentBlock.Num();
-				{
-					FScopeLock ScopeLock(&UnprocessedDataMutex);
+void BFileReader::SetCallbacks(
+	TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+	TFunction<void(TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+	TFunction<void(TSharedPtr<BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+	TFunction<void(TSharedPtr<BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+	TFunction<void(int32, const FString&)> OnErrorAction)
+{
+	OnFileSDKVersionRead = OnFileSDKVersionRead_Callback;
+
+	OnHierarchyNodeRead = OnHierarchyNodeRead_Callback;
+	OnGeometryNodeRead = OnGeometryNodeRead_Callback;
+	OnMetadataNodeRead = OnMetadataNodeRead_Callback;
+
+	OnError = OnErrorAction;
 
-					UnprocessedDataSize -= CurrentBlock.Num();
+	//Every read starts here
+	ProcessedPayloadBytes = 0;
+	ProcessedNodeCount = 0;
+}
+
+void BFileReader::ReadChunk_Internal(uint8* Chunk, int32 Size)
+{
+	if (bInvalidHeader) return;
 
-					TArray<uint8> Ignore;
-					UnprocessedDataQueue.Dequeue(Ignore);
-				}
-				ProcessedBufferCount++;
+	if (!bHeaderRead)
+	{
+		//The version comes first and tells the size of the rest of the header.
+		int32 HeaderSize;
+		while ((HeaderSize = PeekHeaderSize(WaitingHeaderBytes, WaitingHeaderBytes_Num)) != WaitingHeaderBytes_Num)
+		{
+			if (HeaderSize < 0)
+			{
+				bInvalidHeader = true;
+				OnError(400, TEXT("Invalid file header."));
+				return;
 			}
+			if (Size == 0) return;
 
-			int32 SuccessOffset = ReadUntilFailure(CurrentBuffer);
-			if (SuccessOffset == -1) continue;
+			int32 HeaderPart = FMath::Min(Size, HeaderSize - WaitingHeaderBytes_Num);
+			FMemory::Memcpy(WaitingHeaderBytes + WaitingHeaderBytes_Num, Chunk, HeaderPart);
+			WaitingHeaderBytes_Num += HeaderPart;
 
-			int32 NewSize = CurrentBuffer.Num() - SuccessOffset;
-			FailedLeftOverBlock.SetNumUninitialized(NewSize);
+			Chunk += HeaderPart;
+			Size -= HeaderPart;
+		}
+
+		ReadHeader(WaitingHeaderBytes);
+		OnHeaderRead_Internal();
+	}
 
-			for (int32 i = 0; i < NewSize; i++)
-				FailedLeftOverBlock[i] = CurrentBuffer[i + SuccessOffset];
+	if (Size > 0)
+	{
+		if (Telemetry)
+		{
+			const uint64 WriteStartCycles = FPlatformTime::Cycles64();
+			UnprocessedDataRing.Write(Chunk, Size);
+			ReadChunkCycles += FPlatformTime::Cycles64() - WriteStartCycles;
+
+			Telemetry->Add(EBImportCounter_ReaderInputBytes, Size);
 		}
-		if (bInnerStreamReadCompleted && UnprocessedDataQueue.IsEmpty() && UnprocessedDataSize == 0)
+		else
 		{
-			ThreadOperationCompleted->Trigger();
-			return;
+			UnprocessedDataRing.Write(Chunk, Size);
 		}
-		if (ProcessedBufferCount < 32)
+	}
+}
+
+void BFileReader::Process_Internal()
+{
+	//Grows to the largest pending node; then only reused.
+	TArray<uint8> CurrentBuffer;
+
+	while (UnprocessedDataRing.WaitForData())
+	{
+		UnprocessedDataRing.ReadAll(CurrentBuffer);
+
+		const int64 BufferedBytes = (int64)CurrentBuffer.Num() + UnprocessedDataRing.Num();
+		PeakBufferedBytes = FMath::Max(PeakBufferedBytes, BufferedBytes);
+		if (Telemetry)
+		{
+			Telemetry->Sample(EBImportGauge_ReaderBufferedBytes, BufferedBytes);
+		}
+
+		if (bInvalidStream)
 		{
-			FPlatformProcess::Sleep(0.05f);
+			//Node boundaries are lost; drain the rest so that the producer is never blocked.
+			CurrentBuffer.Reset();
+			continue;
+		}
+
+		//Framing already told how many bytes the pending node needs at least; do not look at it again until they arrive.
+		if (CurrentBuffer.Num() < PendingNodeRequiredSize) continue;
+
+		int32 SuccessOffset = ReadUntilFailure(CurrentBuffer);
+		if (SuccessOffset == -1)
+		{
+			CurrentBuffer.Reset();
+		}
+		else if (SuccessOffset > 0)
+		{
+			//Only happens once per node: after this the pending node starts at offset 0 and new data is appended behind it.
+			CurrentBuffer.RemoveAt(0, SuccessOffset, false);
+		}
+
+		if (PendingNodeRequiredSize > CurrentBuffer.Max())
+		{
+			CurrentBuffer.Reserve(PendingNodeRequiredSize);
 		}
 	}
+
+	ThreadOperationCompleted->Trigger();
 }
 //Returns -1 on full success on reading
 int32 BFileReader::ReadUntilFailure(const TArray<uint8>& Input)
 {
-	uint32 SuccessOffset = 0;
+	int32 SuccessOffset = 0;
+	int32 Result = -1;
 
-	while (SuccessOffset < (uint32)Input.Num())
+	//Framing pass; cheap, only reads counts
+	FramedNodes.Reset();
+	while (SuccessOffset < Input.Num())
 	{
-		uint32 ProcessedBytes;
-		if (!TryReadingNode(ProcessedBytes, Input, SuccessOffset))
+		uint32 NodeSize;
+		bool bDecode;
+		EBNodeFramingResult FramingResult = FrameNode(NodeSize, bDecode, Input.GetData() + SuccessOffset, Input.Num() - SuccessOffset);
+
+		if (FramingResult == EBNodeFramingResult_NeedMoreData)
+		{
+			PendingNodeRequiredSize = (int32)NodeSize;
+			Result = SuccessOffset;
+			break;
+		}
+		if (FramingResult == EBNodeFramingResult_Invalid)
 		{
-			return SuccessOffset;
+			bInvalidStream = true;
+			break;
 		}
-		SuccessOffset += ProcessedBytes;
+
+		if (bDecode)
+		{
+			FramedNodes.Add(BNodeExtent{ SuccessOffset, NodeSize });
+		}
+		SuccessOffset += NodeSize;
+		ProcessedPayloadBytes += NodeSize;
+	}
+	if (Result == -1)
+	{
+		PendingNodeRequiredSize = 0;
+	}
+
+	//Decode pass; every framed node is fully available and decoded exactly once.
+	DecodeFramedNodes(Input.GetData());
+
+	if (bInvalidStream)
+	{
+		OnError(400, FString::Printf(TEXT("Invalid node framing at unprocessed data offset %d"), SuccessOffset));
 	}
-	return -1;
+	return Result;
 }
-bool BFileReader::TryReadingNode(uint32& ProcessedBytes, const TArray<uint8>& Input, int32 Offset)
+EBNodeFramingResult BFileReader::FrameNode(uint32& NodeSize, bool& bDecode, const uint8* InHead, int32 AvailableBytes) const
 {
-	if (Offset >= Input.Num()) return false;
+	//Every node starts with its UniqueID; the index block starts with the marker in its place.
+	if (AvailableBytes < (int32)sizeof(uint64))
+	{
+		NodeSize = sizeof(uint64);
+		return EBNodeFramingResult_NeedMoreData;
+	}
 
-	if (FileType == EBNodeType::EBNodeType_Hierarchy)
+	if (BFileNodeIndex::IsIndexAt(InHead, AvailableBytes))
 	{
-		BHierarchyNode NewNode;
+		bDecode = false;
+		return BFileNodeIndex::Frame(NodeSize, InHead, AvailableBytes);
+	}
+
+	if (bFilterNodeIDs)
+	{
+		uint64 UniqueID;
+		FMemory::Memcpy(&UniqueID, InHead, sizeof(uint64));
+		bDecode = NodeIDFilter.Contains(UniqueID);
+	}
+	else
+	{
+		bDecode = true;
+	}
 
-		if (!NewNode.FromBytes(ProcessedBytes, Input.GetData() + Offset, Input)) return false;
-		
-		OnHierarchyNodeRead(NewNode);
+	if (FileType == EBNodeType::EBNodeType_Hierarchy)
+	{
+		return BHierarchyNode::Frame(NodeSize, InHead, AvailableBytes, Flags);
 	}
 	else if (FileType == EBNodeType::EBNodeType_Geometry)
 	{
-		BGeometryNode NewNode;
+		return BGeometryNode::Frame(NodeSize, InHead, AvailableBytes, Flags);
+	}
+	else if (FileType == EBNodeType::EBNodeType_Metadata)
+	{
+		return BMetadataNode::Frame(NodeSize, InHead, AvailableBytes, Flags);
+	}
+	return EBNodeFramingResult_Invalid;
+}
+void BFileReader::DecodeFramedNodes(const uint8* Base)
+{
+	if (FramedNodes.Num() == 0) return;
 
-		if (!NewNode.FromBytes(ProcessedBytes, Input.GetData() + Offset, Input)) return false;
-		
-		OnGeometryNodeRead(NewNode);
+	if (FileType == EBNodeType::EBNodeType_Hierarchy)
+	{
+		DecodeFramedNodes_Internal<BHierarchyNode>(Base, HierarchyNodePool.Get(), OnHierarchyNodeRead);
+	}
+	else if (FileType == EBNodeType::EBNodeType_Geometry)
+	{
+		DecodeFramedNodes_Internal<BGeometryNode>(Base, GeometryNodePool.Get(), OnGeometryNodeRead);
 	}
 	else if (FileType == EBNodeType::EBNodeType_Metadata)
 	{
-		BMetadataNode NewNode;
+		DecodeFramedNodes_Internal<BMetadataNode>(Base, MetadataNodePool.Get(), OnMetadataNodeRead);
+	}
+
+	ProcessedNodeCount += FramedNodes.Num();
+	FramedNodes.Reset();
 
-		if (!NewNode.FromBytes(ProcessedBytes, Input.GetData() + Offset, Input)) return false;
-		
-		OnMetadataNodeRead(NewNode);
+	if (OnProgress)
+	{
+		OnProgress(GetProgress());
 	}
-	else
+}
+template<class NodeType>
+void BFileReader::DecodeFramedNodes_Internal(const uint8* Base, TBFileNodePool<NodeType>& NodePool, const TFunction<void(TSharedPtr<NodeType, ESPMode::ThreadSafe>)>& OnNodeRead)
+{
+	const int32 NodeCount = FramedNodes.Num();
+
+	TArray<TSharedPtr<NodeType, ESPMode::ThreadSafe>> DecodedNodes;
+	DecodedNodes.SetNum(NodeCount);
+
+	TArray<bool> DecodeSucceeded;
+	DecodeSucceeded.SetNumZeroed(NodeCount);
+
+	//Workers pull the next node index; node sizes vary too much for static partitioning.
+	FThreadSafeCounter NextNodeIndex;
+	const int32 WorkerCount = FMath::Clamp(DecodeWorkerCount, 1, NodeCount);
+
+	ParallelFor(WorkerCount, [this, Base, NodeCount, &NodePool, &DecodedNodes, &DecodeSucceeded, &NextNodeIndex](int32 WorkerIndex)
+		{
+			//One telemetry update per worker; the counters are shared by all of them.
+			BFileImportTelemetry::FBScope DecodeScope(Telemetry, EBImportTimer_Decode);
+
+			int32 NodeIndex;
+			while ((NodeIndex = NextNodeIndex.Increment() - 1) < NodeCount)
+			{
+				const BNodeExtent& Extent = FramedNodes[NodeIndex];
+				TArrayView<const uint8> NodeBytes(Base + Extent.Offset, Extent.Size);
+
+				DecodedNodes[NodeIndex] = NodePool.Acquire();
+
+				uint32 ProcessedBytes;
+				DecodeSucceeded[NodeIndex] = DecodedNodes[NodeIndex]->FromBytes(ProcessedBytes, NodeBytes.GetData(), NodeBytes, Flags);
+			}
+		}, WorkerCount == 1/*bForceSingleThread*/);
+
+	if (Telemetry)
 	{
-		return false;
+		int64 DecodedBytes = 0;
+		int32 FailureCount = 0;
+		for (int32 i = 0; i < NodeCount; i++)
+		{
+			DecodedBytes += FramedNodes[i].Size;
+			FailureCount += DecodeSucceeded[i] ? 0 : 1;
+		}
+		Telemetry->Add(EBImportCounter_DecodedBytes, DecodedBytes);
+		Telemetry->Add(EBImportCounter_DecodeFailures, FailureCount);
+		Telemetry->Add(
+			FileType == EBNodeType::EBNodeType_Hierarchy ? EBImportCounter_HierarchyNodes : (FileType == EBNodeType::EBNodeType_Geometry ? EBImportCounter_GeometryNodes : EBImportCounter_MetadataNodes),
+			NodeCount - FailureCount);
+	}
+
+	//Callbacks are delivered on this thread, in stream order. Ownership is handed over; the node is not copied.
+	for (int32 i = 0; i < NodeCount; i++)
+	{
+		if (DecodeSucceeded[i])
+		{
+			if (bFilterNodeIDs)
+			{
+				NodeIDFilter.Remove(DecodedNodes[i]->UniqueID);
+			}
+			OnNodeRead(MoveTemp(DecodedNodes[i]));
+		}
+		else
+		{
+			OnError(400, FString::Printf(TEXT("Node could not be decoded at offset %lld"), FramedNodes[i].Offset));
+		}
 	}
-	return true;
 }
\ No newline at end of file
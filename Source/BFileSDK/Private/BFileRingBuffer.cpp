@@ -0,0 +1,96 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileRingBuffer.h"
+
+BFileRingBuffer::BFileRingBuffer(int32 InCapacity)
+{
+	check(InCapacity > 0);
+
+	Capacity = InCapacity;
+	Data = (uint8*)FMemory::Malloc(Capacity);
+
+	WriteCursor = 0;
+	ReadCursor = 0;
+	bWriterCompleted = false;
+
+	//Auto-reset; each side has exactly one waiter.
+	DataAvailableEvent = FGenericPlatformProcess::GetSynchEventFromPool(false);
+	SpaceAvailableEvent = FGenericPlatformProcess::GetSynchEventFromPool(false);
+}
+
+BFileRingBuffer::~BFileRingBuffer()
+{
+	FGenericPlatformProcess::ReturnSynchEventToPool(DataAvailableEvent);
+	FGenericPlatformProcess::ReturnSynchEventToPool(SpaceAvailableEvent);
+	FMemory::Free(Data);
+}
+
+void BFileRingBuffer::Write(const uint8* InBytes, int32 Size)
+{
+	while (Size > 0)
+	{
+		uint64 CurrentWrite = WriteCursor.Load(EMemoryOrder::Relaxed);
+
+		int32 FreeSpace = Capacity - (int32)(CurrentWrite - ReadCursor.Load());
+		if (FreeSpace == 0)
+		{
+			//If the consumer frees space between the check and the wait; the event stays signaled and wait returns immediately.
+			SpaceAvailableEvent->Wait();
+			continue;
+		}
+
+		int32 WriteOffset = (int32)(CurrentWrite % (uint64)Capacity);
+		int32 Count = FMath::Min3(Size, FreeSpace, Capacity - WriteOffset);
+
+		FMemory::Memcpy(Data + WriteOffset, InBytes, Count);
+
+		WriteCursor = CurrentWrite + Count;
+		DataAvailableEvent->Trigger();
+
+		InBytes += Count;
+		Size -= Count;
+	}
+}
+
+void BFileRingBuffer::MarkWriterCompleted()
+{
+	bWriterCompleted = true;
+	DataAvailableEvent->Trigger();
+}
+
+int32 BFileRingBuffer::ReadAll(TArray<uint8>& Destination)
+{
+	uint64 CurrentRead = ReadCursor.Load(EMemoryOrder::Relaxed);
+	int32 Available = (int32)(WriteCursor.Load() - CurrentRead);
+	if (Available == 0) return 0;
+
+	int32 DestinationOffset = Destination.Num();
+	Destination.AddUninitialized(Available);
+
+	int32 ReadOffset = (int32)(CurrentRead % (uint64)Capacity);
+	int32 FirstPart = FMath::Min(Available, Capacity - ReadOffset);
+
+	FMemory::Memcpy(Destination.GetData() + DestinationOffset, Data + ReadOffset, FirstPart);
+	if (FirstPart < Available)
+	{
+		FMemory::Memcpy(Destination.GetData() + DestinationOffset + FirstPart, Data, Available - FirstPart);
+	}
+
+	ReadCursor = CurrentRead + Available;
+	SpaceAvailableEvent->Trigger();
+
+	return Available;
+}
+
+bool BFileRingBuffer::WaitForData()
+{
+	while (true)
+	{
+		//Completion flag must be observed before the final emptiness check; every write happens-before MarkWriterCompleted.
+		bool bCompleted = bWriterCompleted.Load();
+		if (Num() > 0) return true;
+		if (bCompleted) return false;
+
+		DataAvailableEvent->Wait();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileTangentBasis.h"
+
+//Vertices are transposed into blocks of component streams; the kernel then has no branches or cross-lane dependencies and compilers turn it into packed float instructions.
+#define X_TANGENT_BASIS_BLOCK_SIZE 64
+
+struct FBTangentBasisBlock
+{
+	float NX[X_TANGENT_BASIS_BLOCK_SIZE], NY[X_TANGENT_BASIS_BLOCK_SIZE], NZ[X_TANGENT_BASIS_BLOCK_SIZE];
+	float TX[X_TANGENT_BASIS_BLOCK_SIZE], TY[X_TANGENT_BASIS_BLOCK_SIZE], TZ[X_TANGENT_BASIS_BLOCK_SIZE];
+	float BX[X_TANGENT_BASIS_BLOCK_SIZE], BY[X_TANGENT_BASIS_BLOCK_SIZE], BZ[X_TANGENT_BASIS_BLOCK_SIZE];
+};
+
+static FORCEINLINE void NormalizeStreams(float* RESTRICT X, float* RESTRICT Y, float* RESTRICT Z, int32 Count)
+{
+	for (int32 i = 0; i < Count; i++)
+	{
+		//Degenerate vectors become zero instead of NaN
+		const float SizeSquared = X[i] * X[i] + Y[i] * Y[i] + Z[i] * Z[i];
+		const float Scale = SizeSquared > SMALL_NUMBER ? 1.0f / FMath::Sqrt(SizeSquared) : 0.0f;
+		X[i] *= Scale;
+		Y[i] *= Scale;
+		Z[i] *= Scale;
+	}
+}
+
+static void ComputeBlock(FBTangentBasisBlock& Block, int32 Count)
+{
+	NormalizeStreams(Block.NX, Block.NY, Block.NZ, Count);
+	NormalizeStreams(Block.TX, Block.TY, Block.TZ, Count);
+
+	for (int32 i = 0; i < Count; i++)
+	{
+		Block.BX[i] = Block.NY[i] * Block.TZ[i] - Block.NZ[i] * Block.TY[i];
+		Block.BY[i] = Block.NZ[i] * Block.TX[i] - Block.NX[i] * Block.TZ[i];
+		Block.BZ[i] = Block.NX[i] * Block.TY[i] - Block.NY[i] * Block.TX[i];
+	}
+
+	NormalizeStreams(Block.BX, Block.BY, Block.BZ, Count);
+}
+
+void BFileTangentBasis::Compute(const BGeometryNode::BLOD& InLOD, TArray<FVector>& OutTangentX, TArray<FVector>& OutTangentY, TArray<FVector>& OutTangentZ)
+{
+	const int32 VertexCount = InLOD.GetVertexCount();
+	OutTangentX.SetNumUninitialized(VertexCount);
+	OutTangentY.SetNumUninitialized(VertexCount);
+	OutTangentZ.SetNumUninitialized(VertexCount);
+
+	FBTangentBasisBlock Block;
+
+	for (int32 First = 0; First < VertexCount; First += X_TANGENT_BASIS_BLOCK_SIZE)
+	{
+		const int32 Count = FMath::Min(X_TANGENT_BASIS_BLOCK_SIZE, VertexCount - First);
+
+		for (int32 i = 0; i < Count; i++)
+		{
+			FVector Normal;
+			FVector Tangent;
+			if (InLOD.bPackedVertices)
+			{
+				Normal = InLOD.TangentZ[First + i].ToFVector();
+				Tangent = InLOD.TangentX[First + i].ToFVector();
+			}
+			else
+			{
+				auto& VNT = InLOD.VertexNormalTangentList[First + i];
+				Normal = FVector(VNT.Normal.X, VNT.Normal.Y, VNT.Normal.Z);
+				Tangent = FVector(VNT.Tangent.X, VNT.Tangent.Y, VNT.Tangent.Z);
+			}
+
+			Block.NX[i] = Normal.X; Block.NY[i] = Normal.Y; Block.NZ[i] = Normal.Z;
+			Block.TX[i] = Tangent.X; Block.TY[i] = Tangent.Y; Block.TZ[i] = Tangent.Z;
+		}
+
+		ComputeBlock(Block, Count);
+
+		for (int32 i = 0; i < Count; i++)
+		{
+			OutTangentX[First + i] = FVector(Block.TX[i], Block.TY[i], Block.TZ[i]);
+			OutTangentY[First + i] = FVector(Block.BX[i], Block.BY[i], Block.BZ[i]);
+			OutTangentZ[First + i] = FVector(Block.NX[i], Block.NY[i], Block.NZ[i]);
+		}
+	}
+}
\ No newline at end of file
@@ -58,9 +58,10 @@ private:
 	void OnRootComponentHasMoved();
 #endif
 
-	void InitializeRecursive(
-		TWeakPtr<class BFinalHiearchyNode, ESPMode::ThreadSafe> Node, 
-		TMap<UBSMCSwitcher*, TWeakPtr<class BFinalGeometryPart>>& OneGPartOccurrenceMap, 
+	void InitializeParts(
+		const TArray<class UStaticMesh*>& StaticMeshes,
+		const TArray<class UBSMCSwitcher*>& MeshComponents,
+		TMap<class UBSMCSwitcher*, int32>& OneGPartOccurrenceMap, 
 		TArray<class UBFileAssetHISMComponent*>& HISMCList);
 
 	static float CompressColorAsSingleFloat(const FColor& Color, uint8 Reserved7Bit = 0);
@@ -0,0 +1,92 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/Archive.h"
+#include "Async/Future.h"
+
+//HGM, HG and H outputs: [uint32 Magic][int32 BlockSize], the zlib blocks, then [int64 CompressedOffset][int32 CompressedSize][int32 UncompressedSize] per block,
+//then [int64 TableOffset][int32 BlockCount][int64 UncompressedSize][uint32 Magic]. The table is at the end so that blocks are written as soon as they are compressed.
+//Files that do not start with the magic are a single FArchiveSaveCompressedProxy stream.
+#define X_BLOCK_CONTAINER_MAGIC 0x4B4C4258
+#define X_BLOCK_CONTAINER_BLOCK_SIZE (4 * 1024 * 1024)
+
+struct FBBlockContainerEntry
+{
+	int64 CompressedOffset;
+	int32 CompressedSize;
+	int32 UncompressedSize;
+};
+
+/*
+* Everything serialized into it is cut into blocks; full blocks are compressed on the thread pool and handed to the destination in order.
+* Only a few blocks per worker are held at a time, whatever the total size.
+*/
+class BFILESDK_API BFileBlockContainerWriter : public FArchive
+{
+public:
+	//InWrite returns false when the destination fails; the archive is in error from then on. InTelemetry must outlive the writer.
+	BFileBlockContainerWriter(TFunction<bool(const uint8*, int64)> InWrite, class BFileImportTelemetry* InTelemetry = nullptr);
+	virtual ~BFileBlockContainerWriter();
+
+	virtual void Serialize(void* Data, int64 Num) override;
+	virtual int64 Tell() override { return UncompressedSize; }
+	virtual int64 TotalSize() override { return UncompressedSize; }
+	virtual FString GetArchiveName() const override { return TEXT("BFileBlockContainerWriter"); }
+
+	//Writes the remaining blocks, the table and the footer; nothing may be serialized after. Returns false if anything failed.
+	bool Finish();
+
+	int64 GetContainerSize() const { return ContainerSize; }
+
+private:
+	void SubmitBlock();
+	void WriteOldestBlock();
+	void WriteRaw(const void* Data, int64 Num);
+
+	TFunction<bool(const uint8*, int64)> Write;
+	class BFileImportTelemetry* Telemetry;
+
+	TArray<uint8> CurrentBlock;
+	TArray<TFuture<TArray<uint8>>> InFlightBlocks; //Oldest first; an empty result is a failed block
+	TArray<int32> InFlightBlockSizes;
+	int32 MaxBlocksInFlight;
+
+	TArray<FBBlockContainerEntry> Entries;
+	int64 UncompressedSize = 0;
+	int64 ContainerSize = 0;
+};
+
+/*
+* Reads a container without inflating it as a whole; the blocks ahead of the cursor are inflated in parallel, a window at a time.
+*/
+class BFILESDK_API BFileBlockContainerReader : public FArchive
+{
+public:
+	//InContainer must outlive the reader; the archive is in error when the table does not match the container.
+	BFileBlockContainerReader(const TArray<uint8>& InContainer);
+
+	virtual void Serialize(void* Data, int64 Num) override;
+	virtual int64 Tell() override { return Position; }
+	virtual int64 TotalSize() override { return UncompressedSize; }
+	virtual FString GetArchiveName() const override { return TEXT("BFileBlockContainerReader"); }
+
+	static bool IsBlockContainer(const TArray<uint8>& InBytes);
+
+private:
+	bool ReadTable();
+	void InflateWindow(int32 InFirstBlock);
+
+	const TArray<uint8>& Container;
+	TArray<FBBlockContainerEntry> Entries;
+	int64 UncompressedSize = 0;
+
+	TArray<TArray<uint8>> Window;
+	int32 WindowFirstBlock = 0;
+	int32 WindowCapacity;
+
+	int32 CurrentBlock = 0;
+	int32 OffsetInBlock = 0;
+	int64 Position = 0;
+};
\ No newline at end of file
@@ -0,0 +1,39 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "BFileHeader.h"
+#include <istream>
+
+//LZ4 streams are a sequence of [int32 UncompressedSize][int32 CompressedSize][CompressedBytes] blocks.
+#define X_LZ4_BLOCK_SIZE (1024 * 1024)
+
+class BFILESDK_API BFileCodec
+{
+public:
+	static bool IsAvailable(EBFileCompressionCodec Codec);
+	static const TCHAR* GetName(EBFileCompressionCodec Codec);
+	static bool FromName(const FString& Name, EBFileCompressionCodec& OutCodec);
+
+	//InStream must be positioned after the uncompressed header, if the stream has one (see BFileHeader.h).
+	static bool Decompress(
+		EBFileCompressionCodec Codec,
+		std::istream* InStream,
+		TFunction<void(uint8*, int32)> OnChunkDecompressed,
+		TFunction<void(const FString&)> OnError);
+
+	//Writes a complete compressed stream. Codecs other than deflate need a stream with a v2 header, which is written uncompressed.
+	static bool Compress(
+		EBFileCompressionCodec Codec,
+		const uint8* InBytes,
+		int64 InSize,
+		TArray<uint8>& OutBytes);
+
+private:
+	static bool Decompress_LZ4(std::istream* InStream, TFunction<void(uint8*, int32)> OnChunkDecompressed, TFunction<void(const FString&)> OnError);
+	static bool Decompress_Zstd(std::istream* InStream, TFunction<void(uint8*, int32)> OnChunkDecompressed, TFunction<void(const FString&)> OnError);
+
+	static bool Compress_Deflate(const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes);
+	static bool Compress_LZ4(const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes);
+	static bool Compress_Zstd(const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes);
+};
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include "PackedNormal.h"
+
 #define UNDEFINED_ID 0xFFFFFFFF00000000
 
 enum BFILESDK_API EBNodeType : uint8
@@ -11,6 +13,15 @@ enum BFILESDK_API EBNodeType : uint8
 	EBNodeType_Metadata = 2
 };
 
+//Result of locating a node's extent without decoding it (Frame functions of node types)
+//Complete: NodeSize is the exact byte size of the node; NeedMoreData: NodeSize is the minimum byte size known so far.
+enum BFILESDK_API EBNodeFramingResult : uint8
+{
+	EBNodeFramingResult_Complete = 0,
+	EBNodeFramingResult_NeedMoreData = 1,
+	EBNodeFramingResult_Invalid = 2
+};
+
 struct BFILESDK_API BVector
 {
 	BVector() : X(0), Y(0), Z(0) {}
@@ -41,15 +52,53 @@ public:
 	BNode() {}
 	virtual ~BNode() {}
 
-	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer);
+	//InHeaderFlags: EBFileHeaderFlags of the stream the node is read from
+	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags);
+
+	//Bytes held by a copy of this node, heap allocations included; used for memory budgets.
+	virtual SIZE_T GetAllocatedSize() const;
+};
+
+//Metadata JSON kept as raw UTF-8; the DOM is only built when GetJson is called for the first time.
+class BFILESDK_API BLazyMetadata
+{
+public:
+	//Bytes are trimmed to the outermost braces; anything a decoder left before or after them is dropped.
+	BLazyMetadata(const uint8* InUtf8, int32 InSize);
+	BLazyMetadata(const FString& InJson);
+	~BLazyMetadata();
+
+	BLazyMetadata(const BLazyMetadata&) = delete;
+	BLazyMetadata& operator=(const BLazyMetadata&) = delete;
+
+	TArrayView<const uint8> GetUtf8() const { return Utf8; }
+	FString ToString() const;
+
+	//ToString when it is a valid JSON object, "{}" otherwise; tokens are only scanned, no DOM is built. Used where the text is written out.
+	FString ToValidatedString() const;
+
+	//Thread-safe; invalid JSON results in an empty object.
+	TSharedPtr<class FJsonObject, ESPMode::ThreadSafe> GetJson() const;
+
+	SIZE_T GetAllocatedSize() const { return Utf8.GetAllocatedSize(); }
+
+private:
+	void SetTrimmed(const uint8* InUtf8, int32 InSize);
+
+	TArray<uint8> Utf8;
+
+	//Null until the first GetJson; published once with a compare-and-swap, so no lock is carried per entry.
+	mutable TAtomic<TSharedPtr<class FJsonObject, ESPMode::ThreadSafe>*> Json;
 };
 
 class BFILESDK_API BMetadataNode : public BNode
 {
 public:
-	TSharedPtr<class FJsonObject, ESPMode::ThreadSafe> Metadata;
+	TSharedPtr<BLazyMetadata, ESPMode::ThreadSafe> Metadata;
 
-	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer) override;
+	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags) override;
+	virtual SIZE_T GetAllocatedSize() const override;
+	static EBNodeFramingResult Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes, uint32 InHeaderFlags);
 };
 
 class BFILESDK_API BHierarchyNode : public BNode
@@ -73,7 +122,9 @@ public:
 
 	TArray<uint64> ChildNodes;
 
-	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer) override;
+	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags) override;
+	virtual SIZE_T GetAllocatedSize() const override;
+	static EBNodeFramingResult Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes, uint32 InHeaderFlags);
 };
 
 class BFILESDK_API BGeometryNode : public BNode
@@ -89,10 +140,20 @@ public:
 		};
 		TArray<BVertexNormalTangent> VertexNormalTangentList;
 
+		//Filled instead of VertexNormalTangentList when the stream has quantized geometry; vertices are decoded straight into render formats.
+		bool bPackedVertices = false;
+		TArray<FVector> Positions;
+		TArray<FPackedNormal> TangentX; //Tangent
+		TArray<FPackedNormal> TangentZ; //Normal
+
 		TArray<uint32> Indexes;
+
+		int32 GetVertexCount() const { return bPackedVertices ? Positions.Num() : VertexNormalTangentList.Num(); }
 	};
 
 	TArray<BLOD> LODs;
 
-	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, const TArray<uint8>& Buffer) override;
+	virtual bool FromBytes(uint32& NodeSize, const uint8* InHead, TArrayView<const uint8> Buffer, uint32 InHeaderFlags) override;
+	virtual SIZE_T GetAllocatedSize() const override;
+	static EBNodeFramingResult Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes, uint32 InHeaderFlags);
 };
\ No newline at end of file
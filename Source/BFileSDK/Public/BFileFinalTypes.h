@@ -4,9 +4,6 @@
 
 #include "CoreMinimal.h"
 
-class FArchiveSaveCompressedProxy;
-class FArchiveLoadCompressedProxy;
-
 enum BFILESDK_API EBFileOutputFormat : uint8
 {
 	HGM = 1, //Hierarchy-geometry-metadata combined
@@ -15,6 +12,9 @@ enum BFILESDK_API EBFileOutputFormat : uint8
 	Gs = 4	 //One file per geometry node	
 };
 
+//Set in the format byte of HGM, HG and H files whose hierarchy is written as breadth-first bulk arrays; files without it have one nested record per node.
+#define X_OUTPUT_FORMAT_FLAG_BULK_HIERARCHY 0x80
+
 //Writing to an array; to stream or directly to array?
 struct BFILESDK_API FBFileOutputBufferAlternative
 {
@@ -50,70 +50,70 @@ struct BFILESDK_API FBFileOutputBufferAlternative
 	}
 };
 
-class BFILESDK_API BFinalNode
-{
-public:
-	int64 UniqueID;
-};
-
-class BFILESDK_API BFinalMetadataNode : public BFinalNode
-{
-public:
-	TSharedPtr<class FJsonObject, ESPMode::ThreadSafe> Metadata;
-};
-
-class BFILESDK_API BFinalGeometryNode : public BFinalNode
-{
-public:
-	TArray<uint8> SerializedRenderData;
-};
-
-class BFILESDK_API BFinalGeometryPart
-{
-public:
-	TWeakPtr<BFinalGeometryNode, ESPMode::ThreadSafe> GeometryNode;
-
-	FTransform Transform;
-
-	FColor Color;
-
-	//Only available render-time
-	int32 InstanceIndex;
-};
-
-class BFILESDK_API BFinalHiearchyNode : public BFinalNode
-{
-public:
-	TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> Parent;
-
-	TArray<TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe>> Children;
-
-	TArray<TSharedPtr<BFinalGeometryPart>> Geometries;
-
-	TWeakPtr<BFinalMetadataNode, ESPMode::ThreadSafe> Metadata;
-};
-
+/*
+* Index-based asset content; relations are int32 indexes into the arrays below, INDEX_NONE when absent.
+* Hierarchy nodes are kept in breadth-first order with the root at index 0; children of a node are contiguous, as are parts of a node.
+*/
 class BFILESDK_API BFinalAssetContent
 {
 public:
-	TMap<int64, TSharedPtr<BFinalHiearchyNode, ESPMode::ThreadSafe>> HierarchyIDToNodeMap;
-
-	TMap<int64, TSharedPtr<BFinalGeometryNode, ESPMode::ThreadSafe>> GeometryIDToNodeMap;
-
-	TMap<int64, TSharedPtr<BFinalMetadataNode, ESPMode::ThreadSafe>> MetadataIDToNodeMap;
-
-	TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> RootNode;
+	//Hierarchy nodes
+	TArray<int64> HierarchyIDs;
+	TArray<int32> HierarchyParents;
+	TArray<int32> HierarchyFirstChildren;
+	TArray<int32> HierarchyNextSiblings;
+	TArray<int32> HierarchyMetadata;
+	TArray<int32> HierarchyFirstParts;
+	TArray<int32> HierarchyPartCounts;
+
+	//Geometry parts
+	TArray<int32> PartGeometries;
+	TArray<FTransform> PartTransforms;
+	TArray<FColor> PartColors;
+	TArray<int32> PartInstanceIndexes; //Only available render-time
+
+	//Geometry nodes
+	TArray<int64> GeometryIDs;
+	TArray<TArray<uint8>> GeometrySerializedRenderData;
+
+	//Metadata nodes
+	TArray<int64> MetadataIDs;
+	TArray<TSharedPtr<class BLazyMetadata, ESPMode::ThreadSafe>> Metadata;
+
+	bool HasRoot() const { return HierarchyIDs.Num() > 0; }
+	int32 GetChildCount(int32 InNode) const;
+
+	//Nodes are appended in breadth-first order; InParent and InPreviousSibling (INDEX_NONE for a first child) must already be added. Returns the new index.
+	int32 AddHierarchyNode(int64 InUniqueID, int32 InParent, int32 InPreviousSibling, int32 InMetadata);
+	//Appends a part to the last added hierarchy node.
+	int32 AddPart(int32 InGeometry, const FTransform& InTransform, const FColor& InColor);
+	int32 AddGeometryNode(int64 InUniqueID, TArray<uint8>&& InSerializedRenderData);
+	int32 AddMetadataNode(int64 InUniqueID, TSharedPtr<class BLazyMetadata, ESPMode::ThreadSafe> InMetadata);
+
+	void ReserveHierarchyNodes(int32 InNodeCount, int32 InPartCount);
 
 	bool XSerialize(EBFileOutputFormat OutputFormat, TFunction<FBFileOutputBufferAlternative(int64)> OutputBuffer);
 	void XDeserialize(const TArray<uint8>& SrcBuffer);
 
+	//Optional; XSerialize time and output bytes are reported.
+	void SetTelemetry(class BFileImportTelemetry* InTelemetry) { Telemetry = InTelemetry; }
+
 private:
+	class BFileImportTelemetry* Telemetry = nullptr;
+
 	bool XSerialize_Gs(TFunction<FBFileOutputBufferAlternative(int64)> OutputBuffer);
 	bool XSerialize_Others(EBFileOutputFormat OutputFormat, TFunction<FBFileOutputBufferAlternative(int64)> OutputBuffer);
 
-	void XDeserialize_Gs(FArchiveLoadCompressedProxy& Deserializer);
-	void XDeserialize_Others(EBFileOutputFormat OutputFormat, FArchiveLoadCompressedProxy& Deserializer);
+	void XDeserialize_Gs(FArchive& Deserializer);
+	void XDeserialize_Others(EBFileOutputFormat OutputFormat, bool bBulkHierarchy, FArchive& Deserializer);
+
+	void XSerialize_Hierarchy(FArchive& Serializer) const;
+	void XDeserialize_Hierarchy(FArchive& Deserializer, const TMap<int64, int32>& GeometryIDToIndex, const TMap<int64, int32>& MetadataIDToIndex);
+	//Files written before X_OUTPUT_FORMAT_FLAG_BULK_HIERARCHY; read in preorder, then reordered.
+	void XDeserialize_NestedHierarchy(FArchive& Deserializer, const TMap<int64, int32>& GeometryIDToIndex, const TMap<int64, int32>& MetadataIDToIndex);
 
-	static void XSerialize_Recursive(FArchiveSaveCompressedProxy& Serializer, TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> Node);
-	TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> XDeserialize_Recursive(FArchiveLoadCompressedProxy& Deserializer);
+	void SortHierarchyBreadthFirst();
+	//Fills first child and next sibling links from parents; nodes must be in breadth-first order.
+	void LinkChildren();
+	void ResetHierarchy();
 };
\ No newline at end of file
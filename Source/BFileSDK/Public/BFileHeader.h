@@ -10,13 +10,82 @@ enum EBFileCompressionState : uint8
 	Uncompressed = 1
 };
 
+//Codec of a compressed (x3_c) stream
+enum EBFileCompressionCodec : uint8
+{
+	EBFileCompressionCodec_Deflate = 0,
+	EBFileCompressionCodec_LZ4 = 1,
+	EBFileCompressionCodec_Zstd = 2
+};
+
+//v1 header is FileSDKVersion only; every header starts with it, so this is also the minimum header size.
 #define X_HEADER_SIZE sizeof(uint32)
 
+//v2 header: [uint32 FileSDKVersion][uint32 Magic][uint32 Flags][int64 NodeCount][int64 PayloadSize]
+#define X_HEADER_V2_MAGIC 0x32484642 //"BFH2"
+#define X_HEADER_V2_SIZE (3 * sizeof(uint32) + 2 * sizeof(int64))
+#define X_HEADER_V2_PAYLOAD_SIZE_OFFSET (3 * sizeof(uint32) + sizeof(int64))
+#define X_MAX_HEADER_SIZE X_HEADER_V2_SIZE
+
+#define X_LATEST_FILE_SDK_VERSION 2
+
+//Feature flags of v2 headers
+enum EBFileHeaderFlags : uint32
+{
+	EBFileHeaderFlags_None = 0,
+	EBFileHeaderFlags_QuantizedGeometry = 1 << 0, //Geometry vertices are quantized (see BFileVertexQuantization.h)
+	EBFileHeaderFlags_EncodedIndexes = 1 << 1, //Geometry indexes are [int32 EncodedSize][EncodedSize bytes] after the index count (see BFileIndexCodec.h)
+	EBFileHeaderFlags_CodecMask = 3 << 2 //EBFileCompressionCodec of a compressed stream; see below
+};
+#define X_HEADER_FLAGS_CODEC_SHIFT 2
+
+//Compressed streams of codecs other than deflate start with their v2 header uncompressed, the codec in its flags, followed by the compressed rest.
+//Streams that do not start with a v2 header are deflate as a whole, header included.
+
 class BFILESDK_API BFileHeader
 {
+public:
+	//Appends the v2 header of the uncompressed stream at InBytes with InCodec in its flags; false if the stream has no v2 header.
+	static bool WriteCompressedStreamHeader(EBFileCompressionCodec InCodec, const uint8* InBytes, int64 InSize, TArray<uint8>& OutBytes);
+
+	//Size of the uncompressed header at the start of a compressed stream, 0 for streams that are deflate as a whole; OutCodec is set in both cases.
+	//-1 when the stream starts with a v2 version and magic but ends before the rest of the header.
+	static int32 PeekCompressedStreamHeader(const uint8* InBytes, int32 InSize, EBFileCompressionCodec& OutCodec);
+
+	//Appends a header of the latest version. PayloadSize is the byte count following the header; -1 if not known yet.
+	static void WriteHeader(uint32 InFlags, int64 InNodeCount, int64 InPayloadSize, TArray<uint8>& OutBytes);
+
+	//Updates PayloadSize of the header at the start of InOutStream; v1 headers have no such field and are left as they are.
+	static void UpdatePayloadSize(TArray<uint8>& InOutStream, int64 InPayloadSize);
+
+	//Header size of the stream starting at InBytes, as far as it can be told from InSize bytes (at least X_HEADER_SIZE); -1 if the header is invalid.
+	static int32 PeekHeaderSize(const uint8* InBytes, int32 InSize);
+
+	//Flags of the header starting at InBytes; EBFileHeaderFlags_None for v1 headers or when InSize does not cover the field.
+	static uint32 PeekFlags(const uint8* InBytes, int32 InSize);
+
+	uint32 GetFileSDKVersion() const { return FileSDKVersion; }
+	uint32 GetFlags() const { return Flags; }
+	bool HasFlag(EBFileHeaderFlags InFlag) const { return (Flags & InFlag) != 0; }
+
+	//-1 when unknown (v1 files)
+	int64 GetNodeCount() const { return NodeCount; }
+	int64 GetPayloadSize() const { return PayloadSize; }
+
 protected:
 	uint32 FileSDKVersion = 1;
+	uint32 Flags = EBFileHeaderFlags_None;
+	int64 NodeCount = -1;
+	int64 PayloadSize = -1;
+
+	//Read before decompression; not part of the decompressed header.
+	EBFileCompressionCodec CompressionCodec = EBFileCompressionCodec_Deflate;
+
+	//Sets CompressionCodec; returns the size of the uncompressed header, 0 when the stream is deflate as a whole, -1 when the header is truncated.
+	int32 ReadCompressedStreamHeader(const uint8* InBytes, int32 InSize) { return PeekCompressedStreamHeader(InBytes, InSize, CompressionCodec); }
 
 	int32 GetHeaderSize() const;
+
+	//InBytes must hold PeekHeaderSize bytes. Returns the header size.
 	int32 ReadHeader(const uint8* InBytes);
 };
\ No newline at end of file
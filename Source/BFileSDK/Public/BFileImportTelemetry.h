@@ -0,0 +1,99 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+
+//Timers accumulate thread time; stages running on several threads at once may add up to more than the wall time.
+enum EBImportTimer : uint8
+{
+	EBImportTimer_Inflate = 0, //Decompression, reading the compressed stream included; time blocked on a full reader buffer excluded
+	EBImportTimer_Decode, //FromBytes
+	EBImportTimer_HierarchyNodes, //Creating and linking hierarchy nodes
+	EBImportTimer_MetadataNodes,
+	EBImportTimer_GeometryHash, //Deduplication
+	EBImportTimer_RawMeshExpansion,
+	EBImportTimer_StaticMeshBuild, //UStaticMesh::BatchBuild on the game thread
+	EBImportTimer_RenderDataSerialization, //SerializeStaticMesh or SerializeGeometryNode
+	EBImportTimer_Finalize,
+	EBImportTimer_XSerialize, //Output formats, compression included
+	EBImportTimer_BlockCompression, //Block container of HGM, HG and H outputs; summed over the compressor threads
+	EBImportTimer_MAX
+};
+
+enum EBImportCounter : uint8
+{
+	EBImportCounter_ReaderInputBytes = 0, //Inflated or read, headers excluded
+	EBImportCounter_DecodedBytes,
+	EBImportCounter_HierarchyNodes,
+	EBImportCounter_GeometryNodes,
+	EBImportCounter_MetadataNodes,
+	EBImportCounter_DecodeFailures,
+	EBImportCounter_DeduplicatedGeometryNodes,
+	EBImportCounter_StaticMeshBuildBatches,
+	EBImportCounter_NodeBatches,
+	EBImportCounter_RenderDataBytes,
+	EBImportCounter_OutputBytes,
+	EBImportCounter_MAX
+};
+
+//Gauges keep the last and the peak sampled value.
+enum EBImportGauge : uint8
+{
+	EBImportGauge_ReaderBufferedBytes = 0, //Per reader; sampled by each
+	EBImportGauge_QueuedNodeBytes,
+	EBImportGauge_ActiveTasks,
+	EBImportGauge_PendingStaticMeshBuilds,
+	EBImportGauge_MAX
+};
+
+/*
+* Per-import timers, counters and gauges; all methods are thread-safe and lock-free.
+* Components take a nullable pointer to it; nothing is measured when it is null.
+*/
+class BFILESDK_API BFileImportTelemetry
+{
+public:
+	BFileImportTelemetry();
+
+	BFileImportTelemetry(const BFileImportTelemetry&) = delete;
+	BFileImportTelemetry& operator=(const BFileImportTelemetry&) = delete;
+
+	void AddTime(EBImportTimer InTimer, uint64 InCycles, int64 InCalls = 1);
+	void Add(EBImportCounter InCounter, int64 InValue);
+	void Sample(EBImportGauge InGauge, int64 InValue);
+
+	//Wall time is measured from construction.
+	FString ToJson() const;
+
+	static const TCHAR* GetName(EBImportTimer InTimer);
+	static const TCHAR* GetName(EBImportCounter InCounter);
+	static const TCHAR* GetName(EBImportGauge InGauge);
+
+	//Adds the scope's duration to a timer; InTelemetry may be null.
+	class FBScope
+	{
+	public:
+		FBScope(BFileImportTelemetry* InTelemetry, EBImportTimer InTimer)
+			: Telemetry(InTelemetry), Timer(InTimer), StartCycles(InTelemetry ? FPlatformTime::Cycles64() : 0) {}
+		~FBScope()
+		{
+			if (Telemetry) Telemetry->AddTime(Timer, FPlatformTime::Cycles64() - StartCycles);
+		}
+
+	private:
+		BFileImportTelemetry* Telemetry;
+		EBImportTimer Timer;
+		uint64 StartCycles;
+	};
+
+private:
+	uint64 StartCycles;
+
+	TAtomic<uint64> TimerCycles[EBImportTimer_MAX];
+	TAtomic<int64> TimerCalls[EBImportTimer_MAX];
+	TAtomic<int64> Counters[EBImportCounter_MAX];
+	TAtomic<int64> GaugeLast[EBImportGauge_MAX];
+	TAtomic<int64> GaugePeak[EBImportGauge_MAX];
+};
\ No newline at end of file
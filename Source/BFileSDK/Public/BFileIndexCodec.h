@@ -0,0 +1,31 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+* Triangle list codec for geometry indexes (EBFileHeaderFlags_EncodedIndexes).
+* Each triangle is one code byte, optionally followed by zigzag LEB128 deltas:
+* [bits 0-3: edge FIFO slot][bits 4-5: mode][bits 6-7: rotation]
+* - X_INDEX_CODE_EDGE_NEW: triangle shares an edge in the FIFO; third vertex is the next unseen vertex. No extra bytes.
+* - X_INDEX_CODE_EDGE_DELTA: triangle shares an edge in the FIFO; third vertex follows as a delta to the last explicit vertex.
+* - X_INDEX_CODE_EXPLICIT: all three vertices follow as deltas.
+* Rotation restores the original first vertex so decoding is bit exact.
+* Meshes in vertex cache order hit the edge FIFO for most triangles and decode to about one or two bytes per triangle.
+*/
+#define X_INDEX_CODEC_EDGE_FIFO_SIZE 16
+
+#define X_INDEX_CODE_EDGE_NEW 0
+#define X_INDEX_CODE_EDGE_DELTA 1
+#define X_INDEX_CODE_EXPLICIT 2
+
+class BFILESDK_API BFileIndexCodec
+{
+public:
+	//Appends the encoding of IndexCount indexes (a multiple of 3) to OutBytes.
+	static void Encode(const uint32* InIndexes, int32 IndexCount, TArray<uint8>& OutBytes);
+
+	//Decodes exactly IndexCount indexes into OutIndexes. Fails on malformed input or any index not less than VertexCount.
+	static bool Decode(const uint8* InBytes, int32 InSize, uint32* OutIndexes, int32 IndexCount, int32 VertexCount);
+};
\ No newline at end of file
@@ -11,6 +11,10 @@ private:
 
 public:
 	static void SerializeStaticMesh(class UStaticMesh* StaticMesh, TArray<uint8>& DestBuffer);
+
+	//Writes the same format as SerializeStaticMesh straight from decoded geometry; one render vertex per source vertex, one section per LOD.
+	//Equivalent to building with every build option disabled, without FRawMesh or UStaticMesh; safe on any thread.
+	static void SerializeGeometryNode(const class BGeometryNode& InNode, TArray<uint8>& DestBuffer);
 	static class UStaticMesh* DeserializeToStaticMesh(const TArray<uint8>& SrcBuffer);
 
 	static void DeserializeToStaticMesh_ExecuteThreadablePart(class UStaticMesh* BlankStaticMesh, const TArray<uint8>& SrcBuffer);
@@ -0,0 +1,45 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "BFileCommonTypes.h"
+
+/*
+* Optional index block at the end of an uncompressed node stream:
+* [uint64 X_NODE_INDEX_MARKER_ID][int32 EntryCount][EntryCount x (uint64 UniqueID, int64 Offset, uint32 Size)][int64 IndexOffset][uint64 X_NODE_INDEX_TRAILER_MAGIC]
+* Offsets are from the start of the stream, header included.
+* The marker takes the place of a node UniqueID; sequential readers frame the block and skip it.
+* The fixed-size trailer lets random access readers find the block from the end of the file.
+*/
+#define X_NODE_INDEX_MARKER_ID 0xFFFFFFFFFFFFFFFE
+#define X_NODE_INDEX_TRAILER_MAGIC 0x3158444E49584642 //"BFXINDX1"
+#define X_NODE_INDEX_ENTRY_SIZE (sizeof(uint64) + sizeof(int64) + sizeof(uint32))
+#define X_NODE_INDEX_TRAILER_SIZE (sizeof(int64) + sizeof(uint64))
+
+class BFILESDK_API BFileNodeIndex
+{
+public:
+	struct BEntry
+	{
+		int64 Offset;
+		uint32 Size;
+	};
+
+	//Returns true if the bytes at InHead start an index block; needs at least sizeof(uint64) bytes.
+	static bool IsIndexAt(const uint8* InHead, int32 AvailableBytes);
+
+	//Same contract as node Frame functions; InHead must be at an index block.
+	static EBNodeFramingResult Frame(uint32& NodeSize, const uint8* InHead, int32 AvailableBytes);
+
+	//Frames the nodes of a complete uncompressed stream (header included) and appends an index block. Returns false on invalid framing or if the stream is already indexed.
+	static bool AppendToStream(EBNodeType InFileType, TArray<uint8>& InOutStream);
+
+	//Locates the index through the trailer of a complete uncompressed stream. Returns false if the stream has no valid index.
+	bool FromStream(const uint8* InBytes, int64 InSize);
+
+	const BEntry* Find(uint64 InUniqueID) const { return Entries.Find(InUniqueID); }
+	int32 Num() const { return Entries.Num(); }
+
+private:
+	TMap<uint64, BEntry> Entries;
+};
\ No newline at end of file
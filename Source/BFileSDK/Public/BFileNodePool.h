@@ -0,0 +1,95 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#define NODE_POOL_MAX_POOLED_BYTES (64 * 1024 * 1024)
+
+/*
+* Recycles decoded nodes together with their array allocations.
+* Acquired nodes are handed out as shared pointers; when the last reference is dropped the node returns to the pool (or is deleted if the pool is gone or full),
+* so FromBytes on a recycled node reuses the vertex/index buffers instead of allocating new ones.
+*/
+template<class NodeType>
+class TBFileNodePool : public TSharedFromThis<TBFileNodePool<NodeType>, ESPMode::ThreadSafe>
+{
+public:
+	static TSharedRef<TBFileNodePool<NodeType>, ESPMode::ThreadSafe> Create(int64 InMaxPooledBytes = NODE_POOL_MAX_POOLED_BYTES)
+	{
+		return MakeShareable(new TBFileNodePool<NodeType>(InMaxPooledBytes));
+	}
+
+	~TBFileNodePool()
+	{
+		for (const FPooledNode& Pooled : FreeNodes)
+		{
+			delete Pooled.Node;
+		}
+	}
+
+	//Thread-safe
+	TSharedPtr<NodeType, ESPMode::ThreadSafe> Acquire()
+	{
+		NodeType* Node = nullptr;
+		{
+			FScopeLock Lock(&FreeNodes_Mutex);
+			if (FreeNodes.Num() > 0)
+			{
+				FPooledNode Pooled = FreeNodes.Pop(false);
+				PooledBytes -= Pooled.Size;
+				Node = Pooled.Node;
+			}
+		}
+		if (Node == nullptr)
+		{
+			Node = new NodeType;
+		}
+
+		TWeakPtr<TBFileNodePool<NodeType>, ESPMode::ThreadSafe> WeakPool = this->AsShared();
+		return MakeShareable(Node, [WeakPool](NodeType* ReleasedNode)
+			{
+				TSharedPtr<TBFileNodePool<NodeType>, ESPMode::ThreadSafe> Pool = WeakPool.Pin();
+				if (Pool.IsValid())
+				{
+					Pool->Release(ReleasedNode);
+				}
+				else
+				{
+					delete ReleasedNode;
+				}
+			});
+	}
+
+	int64 GetPooledBytes() const { return PooledBytes; }
+
+private:
+	TBFileNodePool(int64 InMaxPooledBytes) : MaxPooledBytes(InMaxPooledBytes) {}
+
+	void Release(NodeType* Node)
+	{
+		int64 Size = Node->GetAllocatedSize();
+		{
+			FScopeLock Lock(&FreeNodes_Mutex);
+			if (PooledBytes + Size <= MaxPooledBytes)
+			{
+				FreeNodes.Add(FPooledNode{ Node, Size });
+				PooledBytes += Size;
+				return;
+			}
+		}
+		delete Node;
+	}
+
+	struct FPooledNode
+	{
+		NodeType* Node;
+		int64 Size;
+	};
+
+	FCriticalSection FreeNodes_Mutex;
+	TArray<FPooledNode> FreeNodes; //Secured by FreeNodes_Mutex
+	int64 PooledBytes = 0; //Secured by FreeNodes_Mutex
+
+	const int64 MaxPooledBytes;
+};
\ No newline at end of file
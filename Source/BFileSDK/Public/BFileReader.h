@@ -3,50 +3,164 @@
 #pragma once
 
 #include "BFileHeader.h"
+#include "BFileRingBuffer.h"
+#include "BFileNodePool.h"
+#include "BFileImportTelemetry.h"
 #include <istream>
 
+#define UNPROCESSED_DATA_RING_CAPACITY (4 * 1024 * 1024)
+
 class BFILESDK_API BFileReader : public BFileHeader
 {
 public:
-	BFileReader(EBNodeType InFileType)
-	{
-		FileType = InFileType;
-	}
+	//InUnprocessedDataCapacity bounds the bytes buffered between the producer (inflate/stream) and the parser; the producer blocks when it is full.
+	BFileReader(EBNodeType InFileType, int32 InUnprocessedDataCapacity = UNPROCESSED_DATA_RING_CAPACITY);
+
+	//Framing stays on the reader thread; framed nodes are decoded by up to this many workers. 1 decodes on the reader thread only.
+	void SetDecodeWorkerCount(int32 InWorkerCount);
+
+	//Size of the reads issued to uncompressed input streams. Compressed streams are read in the codec's own chunk size.
+	void SetReadChunkSize(int32 InChunkSize);
+
+	//Called once the header is read, before any node; v2 headers carry node count and payload size (see BFileHeader).
+	void SetHeaderReadCallback(TFunction<void(const BFileHeader&)> InOnHeaderRead);
+
+	//Called on the reader thread after each decoded batch with GetProgress().
+	void SetProgressCallback(TFunction<void(float)> InOnProgress);
+
+	//0-1 by payload bytes (or node count) read so far; -1 when the header does not tell the totals (v1 files).
+	float GetProgress() const;
+
+	//Optional; must outlive the reads. Inflate, decode, input bytes, node counts and buffered bytes are reported.
+	void SetTelemetry(BFileImportTelemetry* InTelemetry) { Telemetry = InTelemetry; }
+
+	//Peak of bytes waiting in the ring plus the parse buffer during the last ReadFromStream; valid once it returns.
+	int64 GetPeakBufferedBytes() const { return PeakBufferedBytes; }
 
 	void ReadFromStream(
 		std::istream* InStream, 
 		EBFileCompressionState InCompressionState, 
 		TFunction<void(uint32)> OnFileSDKVersionRead_Callback, 
-		TFunction<void(const class BHierarchyNode&)> OnHierarchyNodeRead_Callback,
-		TFunction<void(const class BGeometryNode&)> OnGeometryNodeRead_Callback,
-		TFunction<void(const class BMetadataNode&)> OnMetadataNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+		TFunction<void(int32, const FString&)> OnErrorAction);
+
+	//Uncompressed files are memory-mapped and parsed in place; falls back to ReadFromStream when mapping is not possible or the file is compressed.
+	void ReadFromFile(
+		const FString& InFilePath,
+		EBFileCompressionState InCompressionState,
+		TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+		TFunction<void(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+		TFunction<void(int32, const FString&)> OnErrorAction);
+
+	//Parses an uncompressed stream (header included) in place, on the calling thread.
+	void ReadFromBytes(
+		const uint8* InBytes,
+		int64 InSize,
+		TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+		TFunction<void(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+		TFunction<void(int32, const FString&)> OnErrorAction);
+
+	//Decodes only the nodes with given IDs. Uncompressed files with a node index (see BFileNodeIndex) are accessed randomly;
+	//otherwise the whole file is read and other nodes are framed but not decoded. IDs that are not found are reported with error 404.
+	void ReadNodesFromFile(
+		const FString& InFilePath,
+		EBFileCompressionState InCompressionState,
+		const TArray<uint64>& InUniqueIDs,
+		TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+		TFunction<void(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+		TFunction<void(int32, const FString&)> OnErrorAction);
+
+	//Same as ReadNodesFromFile for an uncompressed stream (header included) in memory.
+	void ReadNodesFromBytes(
+		const uint8* InBytes,
+		int64 InSize,
+		const TArray<uint64>& InUniqueIDs,
+		TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+		TFunction<void(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
 		TFunction<void(int32, const FString&)> OnErrorAction);
 
 private:
+	void SetCallbacks(
+		TFunction<void(uint32)> OnFileSDKVersionRead_Callback,
+		TFunction<void(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead_Callback,
+		TFunction<void(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead_Callback,
+		TFunction<void(int32, const FString&)> OnErrorAction);
+
+	bool ReadHeaderFromBytes(const uint8* InBytes, int64 InSize, int32& OutHeaderSize);
+	void OnHeaderRead_Internal();
+
 	void ReadChunk_Internal(uint8* Chunk, int32 Size);
 	void Process_Internal();
 	int32 ReadUntilFailure(const TArray<uint8>& Input);
-	bool TryReadingNode(uint32& ProcessedBytes, const TArray<uint8>& Input, int32 Offset);
+	//bDecode is false for the node index block and for nodes filtered out by NodeIDFilter.
+	EBNodeFramingResult FrameNode(uint32& NodeSize, bool& bDecode, const uint8* InHead, int32 AvailableBytes) const;
+	void DecodeFramedNodes(const uint8* Base);
+
+	void BeginNodeIDFilter(const TArray<uint64>& InUniqueIDs);
+	void EndNodeIDFilter();
+
+	template<class NodeType>
+	void DecodeFramedNodes_Internal(const uint8* Base, TBFileNodePool<NodeType>& NodePool, const TFunction<void(TSharedPtr<NodeType, ESPMode::ThreadSafe>)>& OnNodeRead);
+
+	struct BNodeExtent
+	{
+		int64 Offset;
+		uint32 Size;
+	};
+	TArray<BNodeExtent> FramedNodes; //Offsets are relative to the base passed to DecodeFramedNodes
+
+	BFileImportTelemetry* Telemetry = nullptr;
+	uint64 ReadChunkCycles = 0; //Time spent handing chunks to the ring during a ReadFromStream; not codec time
+
+	int32 DecodeWorkerCount;
+	int32 ReadChunkSize;
+
+	//Nodes are handed to callbacks as shared pointers; storage is recycled once every receiver releases them.
+	TSharedRef<TBFileNodePool<class BHierarchyNode>, ESPMode::ThreadSafe> HierarchyNodePool;
+	TSharedRef<TBFileNodePool<class BGeometryNode>, ESPMode::ThreadSafe> GeometryNodePool;
+	TSharedRef<TBFileNodePool<class BMetadataNode>, ESPMode::ThreadSafe> MetadataNodePool;
+
+	//IDs still expected by ReadNodes* calls; found IDs are removed as nodes are delivered.
+	bool bFilterNodeIDs = false;
+	TSet<uint64> NodeIDFilter;
 
 	TFunction<void(uint32)> OnFileSDKVersionRead;
 
-	TFunction<void(const class BHierarchyNode&)> OnHierarchyNodeRead;
-	TFunction<void(const class BGeometryNode&)> OnGeometryNodeRead;
-	TFunction<void(const class BMetadataNode&)> OnMetadataNodeRead;
+	TFunction<void(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe>)> OnHierarchyNodeRead;
+	TFunction<void(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe>)> OnGeometryNodeRead;
+	TFunction<void(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe>)> OnMetadataNodeRead;
 
 	TFunction<void(int32, const FString&)> OnError;
 
+	TFunction<void(const BFileHeader&)> OnHeaderRead;
+	TFunction<void(float)> OnProgress;
+
+	TAtomic<int64> ProcessedPayloadBytes; //Framed bytes after the header, skipped nodes included
+	TAtomic<int64> ProcessedNodeCount; //Decoded nodes
+
 	EBNodeType FileType;
 
 	bool bHeaderRead = false;
-	int32 WaitingDataBlockQueue_Header_TotalSize = 0;
-	TQueue<TArray<uint8>> WaitingDataBlockQueue_Header;
+	bool bInvalidHeader = false;
+	int32 WaitingHeaderBytes_Num = 0;
+	uint8 WaitingHeaderBytes[X_MAX_HEADER_SIZE];
+
+	BFileRingBuffer UnprocessedDataRing; //Producer: stream/inflate thread, consumer: Process_Internal
 
-	TQueue<TArray<uint8>> UnprocessedDataQueue; //Concurrent
-	bool SafePeek_UnprocessedDataQueue(TArray<uint8>& Result);
-	int32 UnprocessedDataSize = 0; //Concurrent
-	FCriticalSection UnprocessedDataMutex;
+	int32 PendingNodeRequiredSize = 0; //Minimum bytes the node at the head of the parse buffer needs; only accessed by Process_Internal
+	bool bInvalidStream = false; //Only accessed by Process_Internal
+	int64 PeakBufferedBytes = 0; //Only modified by Process_Internal
 
-	bool bInnerStreamReadCompleted = false;
 	FEvent* ThreadOperationCompleted;
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+
+/*
+* Fixed-capacity lock-free single-producer/single-consumer byte ring.
+* Producer blocks when the ring is full; consumer blocks when it is empty. Both sides are woken by events, never by polling.
+*/
+class BFILESDK_API BFileRingBuffer
+{
+public:
+	BFileRingBuffer(int32 InCapacity);
+	~BFileRingBuffer();
+
+	BFileRingBuffer(const BFileRingBuffer&) = delete;
+	BFileRingBuffer& operator=(const BFileRingBuffer&) = delete;
+
+	//Producer side; blocks until all bytes are written.
+	void Write(const uint8* InBytes, int32 Size);
+
+	//Producer side; no more Write calls will follow.
+	void MarkWriterCompleted();
+
+	//Consumer side; appends everything currently available to Destination. Returns appended byte count.
+	int32 ReadAll(TArray<uint8>& Destination);
+
+	//Consumer side; blocks until data is available or the writer has completed. Returns false when the ring is drained and the writer has completed.
+	bool WaitForData();
+
+	int32 GetCapacity() const { return Capacity; }
+	int32 Num() const { return (int32)(WriteCursor.Load() - ReadCursor.Load()); }
+
+private:
+	uint8* Data;
+	int32 Capacity;
+
+	TAtomic<uint64> WriteCursor; //Only modified by producer
+	TAtomic<uint64> ReadCursor; //Only modified by consumer
+	TAtomic<bool> bWriterCompleted;
+
+	FEvent* DataAvailableEvent;
+	FEvent* SpaceAvailableEvent;
+};
\ No newline at end of file
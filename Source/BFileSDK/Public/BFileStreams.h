@@ -0,0 +1,86 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <istream>
+#include <streambuf>
+
+/*
+* Read-only std::istream over existing memory; no copy.
+*/
+class BFileMemoryInputStream : public std::istream
+{
+public:
+	BFileMemoryInputStream(const uint8* InBytes, int64 InSize) : std::istream(&Buffer), Buffer(InBytes, InSize) {}
+
+private:
+	class FMemoryBuffer : public std::streambuf
+	{
+	public:
+		FMemoryBuffer(const uint8* InBytes, int64 InSize)
+		{
+			char* Begin = (char*)InBytes;
+			setg(Begin, Begin, Begin + InSize);
+		}
+	};
+	FMemoryBuffer Buffer;
+};
+
+/*
+* Replays bytes that were already consumed from a stream (e.g. while reading an uncompressed header), then continues with the stream itself.
+*/
+class BFilePrefixedInputStream : public std::istream
+{
+public:
+	BFilePrefixedInputStream(const uint8* InPrefix, int32 InPrefixSize, std::istream* InSource) : std::istream(&Buffer), Buffer(InPrefix, InPrefixSize, InSource) {}
+
+private:
+	class FPrefixedBuffer : public std::streambuf
+	{
+	public:
+		FPrefixedBuffer(const uint8* InPrefix, int32 InPrefixSize, std::istream* InSource) : Source(InSource)
+		{
+			Prefix.Append(InPrefix, InPrefixSize);
+			if (Prefix.Num() > 0)
+			{
+				char* Begin = (char*)Prefix.GetData();
+				setg(Begin, Begin, Begin + Prefix.Num());
+			}
+		}
+
+	protected:
+		virtual int_type underflow() override
+		{
+			if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+			std::streamsize Read = Source->read(Chunk, sizeof(Chunk)).gcount();
+			if (Read <= 0) return traits_type::eof();
+
+			setg(Chunk, Chunk, Chunk + Read);
+			return traits_type::to_int_type(*gptr());
+		}
+
+		//Bulk reads bypass the intermediate chunk once the prefix is consumed.
+		virtual std::streamsize xsgetn(char* Destination, std::streamsize Count) override
+		{
+			std::streamsize Copied = FMath::Min<std::streamsize>(Count, egptr() - gptr());
+			if (Copied > 0)
+			{
+				FMemory::Memcpy(Destination, gptr(), Copied);
+				gbump((int)Copied);
+			}
+			if (Copied < Count)
+			{
+				Copied += Source->read(Destination + Copied, Count - Copied).gcount();
+			}
+			return Copied;
+		}
+
+	private:
+		TArray<uint8> Prefix;
+		std::istream* Source;
+		char Chunk[8192];
+	};
+	FPrefixedBuffer Buffer;
+};
\ No newline at end of file
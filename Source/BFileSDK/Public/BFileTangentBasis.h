@@ -0,0 +1,13 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BFileCommonTypes.h"
+
+class BFILESDK_API BFileTangentBasis
+{
+public:
+	//Per-vertex basis of a LOD, computed once per vertex: TangentX is the tangent, TangentZ the normal, TangentY Normal x Tangent; all unit length.
+	static void Compute(const BGeometryNode::BLOD& InLOD, TArray<FVector>& OutTangentX, TArray<FVector>& OutTangentY, TArray<FVector>& OutTangentZ);
+};
\ No newline at end of file
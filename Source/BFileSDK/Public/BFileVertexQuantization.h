@@ -0,0 +1,59 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//Quantized geometry vertex (EBFileHeaderFlags_QuantizedGeometry): [uint16 X, Y, Z][int16 Normal octahedral X, Y][int16 Tangent octahedral X, Y]
+//Positions are relative to the node's bounding box which precedes the LODs: [float MinX, MinY, MinZ][float ExtentX, ExtentY, ExtentZ]
+#define X_QUANTIZED_VERTEX_SIZE (3 * sizeof(uint16) + 4 * sizeof(int16))
+#define X_QUANTIZED_BOUNDS_SIZE (6 * sizeof(float))
+
+#define X_QUANTIZED_POSITION_MAX 65535.0f
+#define X_OCTAHEDRAL_MAX 32767.0f
+
+class BFileVertexQuantization
+{
+public:
+	static FORCEINLINE uint16 QuantizePosition(float Value, float Min, float Extent)
+	{
+		if (Extent <= 0.0f) return 0;
+		return (uint16)FMath::Clamp(FMath::RoundToInt((Value - Min) / Extent * X_QUANTIZED_POSITION_MAX), 0, (int32)MAX_uint16);
+	}
+
+	static FORCEINLINE float DequantizePosition(uint16 Quantized, float Min, float Extent)
+	{
+		return Min + Quantized * (Extent / X_QUANTIZED_POSITION_MAX);
+	}
+
+	//Unit vector to the octahedron unfolded on [-1, 1]^2
+	static FORCEINLINE void EncodeOctahedral(FVector Vector, int16& OutX, int16& OutY)
+	{
+		const float L1 = FMath::Abs(Vector.X) + FMath::Abs(Vector.Y) + FMath::Abs(Vector.Z);
+		float X = L1 > 0.0f ? Vector.X / L1 : 0.0f;
+		float Y = L1 > 0.0f ? Vector.Y / L1 : 0.0f;
+
+		if (Vector.Z < 0.0f)
+		{
+			const float FoldedX = (1.0f - FMath::Abs(Y)) * (X >= 0.0f ? 1.0f : -1.0f);
+			const float FoldedY = (1.0f - FMath::Abs(X)) * (Y >= 0.0f ? 1.0f : -1.0f);
+			X = FoldedX;
+			Y = FoldedY;
+		}
+
+		OutX = (int16)FMath::RoundToInt(FMath::Clamp(X, -1.0f, 1.0f) * X_OCTAHEDRAL_MAX);
+		OutY = (int16)FMath::RoundToInt(FMath::Clamp(Y, -1.0f, 1.0f) * X_OCTAHEDRAL_MAX);
+	}
+
+	static FORCEINLINE FVector DecodeOctahedral(int16 InX, int16 InY)
+	{
+		FVector Vector(InX / X_OCTAHEDRAL_MAX, InY / X_OCTAHEDRAL_MAX, 0.0f);
+		Vector.Z = 1.0f - FMath::Abs(Vector.X) - FMath::Abs(Vector.Y);
+
+		const float Fold = FMath::Max(-Vector.Z, 0.0f);
+		Vector.X += Vector.X >= 0.0f ? -Fold : Fold;
+		Vector.Y += Vector.Y >= 0.0f ? -Fold : Fold;
+
+		return Vector.GetSafeNormal();
+	}
+};
\ No newline at end of file
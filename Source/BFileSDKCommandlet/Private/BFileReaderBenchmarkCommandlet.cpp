@@ -0,0 +1,267 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileReaderBenchmarkCommandlet.h"
+#include "BFileSDKCommandlet.h"
+#include "BFileSyntheticStream.h"
+#include "BFileReader.h"
+#include "BFileCodec.h"
+#include "BFileStreams.h"
+#include "Misc/FileHelper.h"
+#include "Async/TaskGraphInterfaces.h"
+
+#define BYTES_TO_MB(Bytes) ((double)(Bytes) / (1024.0 * 1024.0))
+#define THROUGHPUT(Amount, Seconds) ((double)(Amount) / FMath::Max((Seconds), (double)SMALL_NUMBER))
+
+static const TCHAR* GetFileTypeName(EBNodeType FileType)
+{
+	switch (FileType)
+	{
+	case EBNodeType::EBNodeType_Hierarchy: return TEXT("hierarchy");
+	case EBNodeType::EBNodeType_Geometry: return TEXT("geometry");
+	default: return TEXT("metadata");
+	}
+}
+
+UBFileReaderBenchmarkCommandlet::UBFileReaderBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBFileReaderBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString InputPath;
+	FString FileTypeNames = TEXT("hierarchy,geometry,metadata");
+	FString CompressionNames = TEXT("none,deflate,lz4,zstd");
+	FString ChunkSizeValues = TEXT("8192,65536,1048576");
+	FString ThreadCountValues = FString::Printf(TEXT("1,%d"), FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+
+	FParse::Value(*Params, TEXT("Input="), InputPath);
+	FParse::Value(*Params, TEXT("FileType="), FileTypeNames);
+	FParse::Value(*Params, TEXT("Compression="), CompressionNames);
+	FParse::Value(*Params, TEXT("ChunkSizes="), ChunkSizeValues);
+	FParse::Value(*Params, TEXT("Threads="), ThreadCountValues);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	Iterations = FMath::Max(1, Iterations);
+
+	FBSyntheticStreamOptions SyntheticOptions;
+	FParse::Value(*Params, TEXT("Nodes="), SyntheticOptions.NodeCount);
+	FParse::Value(*Params, TEXT("Vertices="), SyntheticOptions.VertexCount);
+	FParse::Value(*Params, TEXT("LODs="), SyntheticOptions.LODCount);
+	FParse::Value(*Params, TEXT("Parts="), SyntheticOptions.PartCount);
+	FParse::Value(*Params, TEXT("Children="), SyntheticOptions.ChildCount);
+	FParse::Value(*Params, TEXT("MetadataBytes="), SyntheticOptions.MetadataBytes);
+	FParse::Value(*Params, TEXT("Seed="), SyntheticOptions.Seed);
+	SyntheticOptions.bQuantizedGeometry = FParse::Param(*Params, TEXT("Quantized"));
+	SyntheticOptions.bEncodedIndexes = FParse::Param(*Params, TEXT("EncodedIndexes"));
+
+	TArray<EBNodeType> FileTypes;
+	if (!ParseFileTypes(FileTypeNames, FileTypes) || (!InputPath.IsEmpty() && FileTypes.Num() != 1))
+	{
+		UE_LOG(LogCommandletPlugin, Error, TEXT("-FileType must be one of hierarchy, geometry, metadata (a list for synthetic streams). Given: %s"), *FileTypeNames);
+		return 1;
+	}
+	if (!ParseCompressions(CompressionNames))
+	{
+		UE_LOG(LogCommandletPlugin, Error, TEXT("-Compression must be a list of none, deflate, lz4, zstd. Given: %s"), *CompressionNames);
+		return 1;
+	}
+	if (!ParseIntegers(ChunkSizeValues, ChunkSizes) || !ParseIntegers(ThreadCountValues, ThreadCounts))
+	{
+		UE_LOG(LogCommandletPlugin, Error, TEXT("-ChunkSizes and -Threads must be lists of positive integers."));
+		return 1;
+	}
+
+	for (EBNodeType FileType : FileTypes)
+	{
+		TArray<uint8> UncompressedStream;
+		if (!InputPath.IsEmpty())
+		{
+			if (!FFileHelper::LoadFileToArray(UncompressedStream, *InputPath))
+			{
+				UE_LOG(LogCommandletPlugin, Error, TEXT("-Input could not be read: %s"), *InputPath);
+				return 1;
+			}
+			UE_LOG(LogCommandletPlugin, Display, TEXT("%s: %s, %.2f MB"), GetFileTypeName(FileType), *InputPath, BYTES_TO_MB(UncompressedStream.Num()));
+		}
+		else
+		{
+			BFileSyntheticStream::Generate(FileType, SyntheticOptions, UncompressedStream);
+			UE_LOG(LogCommandletPlugin, Display, TEXT("%s: synthetic, %d nodes, %.2f MB"), GetFileTypeName(FileType), SyntheticOptions.NodeCount, BYTES_TO_MB(UncompressedStream.Num()));
+		}
+
+		BenchmarkStream(FileType, UncompressedStream);
+	}
+	return 0;
+}
+
+bool UBFileReaderBenchmarkCommandlet::ParseFileTypes(const FString& Names, TArray<EBNodeType>& OutFileTypes) const
+{
+	TArray<FString> Split;
+	Names.ParseIntoArray(Split, TEXT(","), true);
+
+	for (const FString& Name : Split)
+	{
+		FString Trimmed = Name.TrimStartAndEnd();
+		if (Trimmed.Equals(TEXT("hierarchy"), ESearchCase::IgnoreCase)) OutFileTypes.Add(EBNodeType::EBNodeType_Hierarchy);
+		else if (Trimmed.Equals(TEXT("geometry"), ESearchCase::IgnoreCase)) OutFileTypes.Add(EBNodeType::EBNodeType_Geometry);
+		else if (Trimmed.Equals(TEXT("metadata"), ESearchCase::IgnoreCase)) OutFileTypes.Add(EBNodeType::EBNodeType_Metadata);
+		else return false;
+	}
+	return OutFileTypes.Num() > 0;
+}
+
+bool UBFileReaderBenchmarkCommandlet::ParseCompressions(const FString& Names)
+{
+	TArray<FString> Split;
+	Names.ParseIntoArray(Split, TEXT(","), true);
+
+	for (const FString& Name : Split)
+	{
+		FString Trimmed = Name.TrimStartAndEnd();
+		if (Trimmed.Equals(TEXT("none"), ESearchCase::IgnoreCase))
+		{
+			bBenchmarkUncompressed = true;
+			continue;
+		}
+
+		EBFileCompressionCodec Codec;
+		if (!BFileCodec::FromName(Trimmed, Codec)) return false;
+		Codecs.Add(Codec);
+	}
+	return bBenchmarkUncompressed || Codecs.Num() > 0;
+}
+
+bool UBFileReaderBenchmarkCommandlet::ParseIntegers(const FString& Values, TArray<int32>& OutValues) const
+{
+	TArray<FString> Split;
+	Values.ParseIntoArray(Split, TEXT(","), true);
+
+	for (const FString& Value : Split)
+	{
+		int32 Parsed = FCString::Atoi(*Value);
+		if (Parsed <= 0) return false;
+		OutValues.Add(Parsed);
+	}
+	return OutValues.Num() > 0;
+}
+
+void UBFileReaderBenchmarkCommandlet::BenchmarkStream(EBNodeType FileType, const TArray<uint8>& UncompressedStream)
+{
+	if (bBenchmarkUncompressed)
+	{
+		for (int32 ChunkSize : ChunkSizes)
+		{
+			BenchmarkRead(TEXT("none"), FileType, UncompressedStream, EBFileCompressionState::Uncompressed, UncompressedStream.Num(), ChunkSize);
+		}
+	}
+
+	for (EBFileCompressionCodec Codec : Codecs)
+	{
+		if (!BFileCodec::IsAvailable(Codec))
+		{
+			UE_LOG(LogCommandletPlugin, Warning, TEXT("%s: not available in this build; skipped."), BFileCodec::GetName(Codec));
+			continue;
+		}
+		BenchmarkCodec(Codec, FileType, UncompressedStream);
+	}
+}
+
+void UBFileReaderBenchmarkCommandlet::BenchmarkCodec(EBFileCompressionCodec Codec, EBNodeType FileType, const TArray<uint8>& UncompressedStream)
+{
+	const TCHAR* CodecName = BFileCodec::GetName(Codec);
+
+	TArray<uint8> CompressedStream;
+
+	double CompressSeconds = 0.0;
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		double Start = FPlatformTime::Seconds();
+		if (!BFileCodec::Compress(Codec, UncompressedStream.GetData(), UncompressedStream.Num(), CompressedStream))
+		{
+			UE_LOG(LogCommandletPlugin, Error, TEXT("%s: compression failed."), CodecName);
+			return;
+		}
+		CompressSeconds += FPlatformTime::Seconds() - Start;
+	}
+
+	//Decompression only; output is discarded
+	EBFileCompressionCodec StreamCodec;
+	const int32 HeaderSize = BFileHeader::PeekCompressedStreamHeader(CompressedStream.GetData(), CompressedStream.Num(), StreamCodec);
+
+	double DecompressSeconds = 0.0;
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		BFileMemoryInputStream CodecStream(CompressedStream.GetData() + HeaderSize, CompressedStream.Num() - HeaderSize);
+
+		double Start = FPlatformTime::Seconds();
+		BFileCodec::Decompress(Codec, &CodecStream,
+			[](uint8* Buffer, int32 Size) {},
+			[CodecName](const FString& ErrorMessage)
+			{
+				UE_LOG(LogCommandletPlugin, Error, TEXT("%s: %s"), CodecName, *ErrorMessage);
+			});
+		DecompressSeconds += FPlatformTime::Seconds() - Start;
+	}
+
+	const double UncompressedMB = BYTES_TO_MB(UncompressedStream.Num()) * Iterations;
+
+	UE_LOG(LogCommandletPlugin, Display, TEXT("%-9s %-8s ratio %6.3f | compress %9.2f MB/s | decompress %9.2f MB/s"),
+		GetFileTypeName(FileType), CodecName,
+		(double)CompressedStream.Num() / FMath::Max(1, UncompressedStream.Num()),
+		THROUGHPUT(UncompressedMB, CompressSeconds),
+		THROUGHPUT(UncompressedMB, DecompressSeconds));
+
+	BenchmarkRead(CodecName, FileType, CompressedStream, EBFileCompressionState::Compressed, UncompressedStream.Num(), 0);
+}
+
+void UBFileReaderBenchmarkCommandlet::BenchmarkRead(const TCHAR* CompressionName, EBNodeType FileType, const TArray<uint8>& Stream, EBFileCompressionState CompressionState, int64 UncompressedSize, int32 ChunkSize)
+{
+	for (int32 ThreadCount : ThreadCounts)
+	{
+		double ReadSeconds = 0.0;
+		int64 NodeCount = 0;
+		for (int32 i = 0; i < Iterations; i++)
+		{
+			double Start = FPlatformTime::Seconds();
+			NodeCount += ReadStream(FileType, Stream, CompressionState, ChunkSize, ThreadCount);
+			ReadSeconds += FPlatformTime::Seconds() - Start;
+		}
+
+		UE_LOG(LogCommandletPlugin, Display, TEXT("%-9s %-8s chunk %8s | threads %3d | read %9.2f MB/s, %12.0f nodes/s"),
+			GetFileTypeName(FileType), CompressionName,
+			ChunkSize > 0 ? *FString::FromInt(ChunkSize) : TEXT("codec"),
+			ThreadCount,
+			THROUGHPUT(BYTES_TO_MB(UncompressedSize) * Iterations, ReadSeconds),
+			THROUGHPUT(NodeCount, ReadSeconds));
+	}
+}
+
+int64 UBFileReaderBenchmarkCommandlet::ReadStream(EBNodeType FileType, const TArray<uint8>& Stream, EBFileCompressionState CompressionState, int32 ChunkSize, int32 ThreadCount)
+{
+	//Callbacks are delivered on the reader thread; no synchronization needed.
+	int64 NodeCount = 0;
+
+	BFileMemoryInputStream InStream(Stream.GetData(), Stream.Num());
+
+	BFileReader Reader(FileType);
+	Reader.SetDecodeWorkerCount(ThreadCount);
+	if (ChunkSize > 0)
+	{
+		Reader.SetReadChunkSize(ChunkSize);
+	}
+
+	Reader.ReadFromStream(&InStream, CompressionState,
+		[](uint32 FileSDKVersion) {},
+		[&NodeCount](TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe> Node) { NodeCount++; },
+		[&NodeCount](TSharedPtr<BGeometryNode, ESPMode::ThreadSafe> Node) { NodeCount++; },
+		[&NodeCount](TSharedPtr<BMetadataNode, ESPMode::ThreadSafe> Node) { NodeCount++; },
+		[](int32 ErrorCode, const FString& ErrorMessage)
+		{
+			UE_LOG(LogCommandletPlugin, Error, TEXT("BFileReader->Error: %s"), *ErrorMessage);
+		});
+
+	return NodeCount;
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#include "BFileSyntheticStream.h"
+#include "BFileHeader.h"
+#include "BFileVertexQuantization.h"
+#include "BFileIndexCodec.h"
+#include "Math/RandomStream.h"
+
+#define XAppendToBytes(STREAM, SRC) STREAM.Append((const uint8*)&SRC, sizeof(SRC))
+
+//Generated vertices lie on a sphere of this radius
+#define X_SYNTHETIC_GEOMETRY_RADIUS 100.0f
+
+void BFileSyntheticStream::Generate(EBNodeType InFileType, const FBSyntheticStreamOptions& InOptions, TArray<uint8>& OutStream)
+{
+	FRandomStream Random(InOptions.Seed);
+
+	OutStream.Reset();
+
+	uint32 HeaderFlags = EBFileHeaderFlags_None;
+	if (InFileType == EBNodeType::EBNodeType_Geometry)
+	{
+		if (InOptions.bQuantizedGeometry) HeaderFlags |= EBFileHeaderFlags_QuantizedGeometry;
+		if (InOptions.bEncodedIndexes) HeaderFlags |= EBFileHeaderFlags_EncodedIndexes;
+	}
+	BFileHeader::WriteHeader(HeaderFlags, InOptions.NodeCount, -1, OutStream);
+	const int32 HeaderSize = OutStream.Num();
+
+	for (int32 i = 0; i < InOptions.NodeCount; i++)
+	{
+		switch (InFileType)
+		{
+		case EBNodeType::EBNodeType_Hierarchy:
+			GenerateHierarchyNode(i, InOptions, Random, OutStream);
+			break;
+		case EBNodeType::EBNodeType_Geometry:
+			GenerateGeometryNode(i, InOptions, Random, OutStream);
+			break;
+		default:
+			GenerateMetadataNode(i, InOptions, Random, OutStream);
+			break;
+		}
+	}
+
+	BFileHeader::UpdatePayloadSize(OutStream, OutStream.Num() - HeaderSize);
+}
+
+void BFileSyntheticStream::GenerateHierarchyNode(uint64 InNodeID, const FBSyntheticStreamOptions& InOptions, FRandomStream& Random, TArray<uint8>& OutStream)
+{
+	const uint64 ChildCount = FMath::Max(1, InOptions.ChildCount);
+
+	uint64 ParentID = InNodeID == 0 ? UNDEFINED_ID : (InNodeID - 1) / ChildCount;
+	XAppendToBytes(OutStream, InNodeID);
+	XAppendToBytes(OutStream, ParentID);
+	XAppendToBytes(OutStream, InNodeID); //MetadataID
+
+	int32 PartCount = InOptions.PartCount;
+	XAppendToBytes(OutStream, PartCount);
+	for (int32 i = 0; i < PartCount; i++)
+	{
+		uint64 GeometryID = (uint64)Random.RandHelper(FMath::Max(1, InOptions.NodeCount));
+		XAppendToBytes(OutStream, GeometryID);
+
+		float Transform[9] =
+		{
+			Random.FRandRange(-1000.0f, 1000.0f), Random.FRandRange(-1000.0f, 1000.0f), Random.FRandRange(-1000.0f, 1000.0f), //Location
+			Random.FRandRange(-180.0f, 180.0f), Random.FRandRange(-180.0f, 180.0f), Random.FRandRange(-180.0f, 180.0f), //Rotation
+			1.0f, 1.0f, 1.0f //Scale
+		};
+		OutStream.Append((const uint8*)Transform, sizeof(Transform));
+
+		uint8 Color[3] = { (uint8)Random.RandHelper(256), (uint8)Random.RandHelper(256), (uint8)Random.RandHelper(256) };
+		OutStream.Append(Color, sizeof(Color));
+	}
+
+	TArray<uint64> ChildNodes;
+	for (uint64 ChildID = InNodeID * ChildCount + 1; ChildID <= InNodeID * ChildCount + ChildCount && ChildID < (uint64)InOptions.NodeCount; ChildID++)
+	{
+		ChildNodes.Add(ChildID);
+	}
+	int32 ChildNodesSize = ChildNodes.Num();
+	XAppendToBytes(OutStream, ChildNodesSize);
+	OutStream.Append((const uint8*)ChildNodes.GetData(), ChildNodesSize * sizeof(uint64));
+}
+
+void BFileSyntheticStream::GenerateGeometryNode(uint64 InNodeID, const FBSyntheticStreamOptions& InOptions, FRandomStream& Random, TArray<uint8>& OutStream)
+{
+	XAppendToBytes(OutStream, InNodeID);
+
+	int8 LODCount = (int8)FMath::Clamp(InOptions.LODCount, 0, (int32)MAX_int8);
+	XAppendToBytes(OutStream, LODCount);
+
+	//Min XYZ, Extent XYZ
+	const float Bounds[6] =
+	{
+		-X_SYNTHETIC_GEOMETRY_RADIUS, -X_SYNTHETIC_GEOMETRY_RADIUS, -X_SYNTHETIC_GEOMETRY_RADIUS,
+		2.0f * X_SYNTHETIC_GEOMETRY_RADIUS, 2.0f * X_SYNTHETIC_GEOMETRY_RADIUS, 2.0f * X_SYNTHETIC_GEOMETRY_RADIUS
+	};
+	if (InOptions.bQuantizedGeometry && LODCount > 0)
+	{
+		OutStream.Append((const uint8*)Bounds, sizeof(Bounds));
+	}
+
+	for (int8 LOD = 0; LOD < LODCount; LOD++)
+	{
+		//Every LOD halves the vertex count
+		int32 VNTCount = FMath::Max(3, InOptions.VertexCount >> LOD);
+		XAppendToBytes(OutStream, VNTCount);
+
+		for (int32 i = 0; i < VNTCount; i++)
+		{
+			FVector Vertex = Random.GetUnitVector() * X_SYNTHETIC_GEOMETRY_RADIUS;
+			FVector Normal = Vertex.GetSafeNormal();
+			FVector Tangent = FVector::CrossProduct(Normal, FVector::UpVector).GetSafeNormal();
+
+			if (InOptions.bQuantizedGeometry)
+			{
+				uint16 Position[3] =
+				{
+					BFileVertexQuantization::QuantizePosition(Vertex.X, Bounds[0], Bounds[3]),
+					BFileVertexQuantization::QuantizePosition(Vertex.Y, Bounds[1], Bounds[4]),
+					BFileVertexQuantization::QuantizePosition(Vertex.Z, Bounds[2], Bounds[5])
+				};
+				int16 Octahedral[4];
+				BFileVertexQuantization::EncodeOctahedral(Normal, Octahedral[0], Octahedral[1]);
+				BFileVertexQuantization::EncodeOctahedral(Tangent, Octahedral[2], Octahedral[3]);
+
+				OutStream.Append((const uint8*)Position, sizeof(Position));
+				OutStream.Append((const uint8*)Octahedral, sizeof(Octahedral));
+			}
+			else
+			{
+				float VNT[9] = { Vertex.X, Vertex.Y, Vertex.Z, Normal.X, Normal.Y, Normal.Z, Tangent.X, Tangent.Y, Tangent.Z };
+				OutStream.Append((const uint8*)VNT, sizeof(VNT));
+			}
+		}
+
+		int32 IndexCount = VNTCount - VNTCount % 3;
+		XAppendToBytes(OutStream, IndexCount);
+
+		TArray<uint32> Indexes;
+		Indexes.SetNumUninitialized(IndexCount);
+		for (int32 i = 0; i < IndexCount; i++)
+		{
+			Indexes[i] = (uint32)Random.RandHelper(VNTCount);
+		}
+
+		if (InOptions.bEncodedIndexes)
+		{
+			TArray<uint8> EncodedIndexes;
+			BFileIndexCodec::Encode(Indexes.GetData(), IndexCount, EncodedIndexes);
+
+			int32 EncodedSize = EncodedIndexes.Num();
+			XAppendToBytes(OutStream, EncodedSize);
+			OutStream.Append(EncodedIndexes);
+		}
+		else
+		{
+			OutStream.Append((const uint8*)Indexes.GetData(), IndexCount * sizeof(uint32));
+		}
+	}
+}
+
+void BFileSyntheticStream::GenerateMetadataNode(uint64 InNodeID, const FBSyntheticStreamOptions& InOptions, FRandomStream& Random, TArray<uint8>& OutStream)
+{
+	FString Json = FString::Printf(TEXT("{\"id\":%llu,\"name\":\"Node_%llu\",\"weight\":%.3f,\"payload\":\""), InNodeID, InNodeID, Random.FRandRange(0.0f, 1000.0f));
+	while (Json.Len() < InOptions.MetadataBytes - 2)
+	{
+		Json.AppendChar(TEXT('a') + Random.RandHelper(26));
+	}
+	Json.Append(TEXT("\"}"));
+
+	FTCHARToUTF8 Utf8(*Json);
+
+	XAppendToBytes(OutStream, InNodeID);
+
+	int32 MetadataSize = Utf8.Length();
+	XAppendToBytes(OutStream, MetadataSize);
+	OutStream.Append((const uint8*)Utf8.Get(), MetadataSize);
+}
\ No newline at end of file
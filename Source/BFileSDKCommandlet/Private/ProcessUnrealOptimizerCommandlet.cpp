@@ -95,6 +95,21 @@ int32 UProcessUnrealOptimizerCommandlet::Main(const FString& Params)
     InputOption.GeometryFileStream = &IStreamToDownload_For_XCG_File;
     InputOption.MetadataFileStream = &IStreamToDownload_For_XCM_File;
 
+    //Optional memory bounds; e.g. -ReaderBufferMB=4 -QueuedNodeMB=512
+    int32 ReaderBufferMB = 0;
+    int32 QueuedNodeMB = 0;
+    FParse::Value(*Params, TEXT("ReaderBufferMB="), ReaderBufferMB);
+    FParse::Value(*Params, TEXT("QueuedNodeMB="), QueuedNodeMB);
+    //Values of zero or less keep the defaults; the reader buffer is an int32 byte count, so it is clamped below 2 GB.
+    if (ReaderBufferMB > 0)
+    {
+        InputOption.ReaderBufferBytes = (int32)FMath::Min<int64>((int64)ReaderBufferMB * 1024 * 1024, MAX_int32);
+    }
+    if (QueuedNodeMB > 0)
+    {
+        InputOption.QueuedNodeBytesBudget = (int64)QueuedNodeMB * 1024 * 1024;
+    }
+
     FBFileFactoryOutputOption OutputOption;
     AddOutputFileProcessor(OutputOption, EBFileOutputFormat::HGM);
     AddOutputFileProcessor(OutputOption, EBFileOutputFormat::HG);
@@ -105,6 +120,22 @@ int32 UProcessUnrealOptimizerCommandlet::Main(const FString& Params)
     bool bResult = AssetFactory->FactoryCreateFile_InGameThread(OutputOption, InputOption);
     AssetFactory = nullptr;
 
+    UE_LOG(LogCommandletPlugin, Display, TEXT("Peak buffered bytes: readers %lld, queued nodes %lld"), OutputOption.PeakReaderBufferedBytes, OutputOption.PeakQueuedNodeBytes);
+
+    //Optional; e.g. -TelemetryReport=/tmp/import_telemetry.json
+    FString TelemetryReportPath;
+    if (FParse::Value(*Params, TEXT("TelemetryReport="), TelemetryReportPath) && !TelemetryReportPath.IsEmpty())
+    {
+        if (FFileHelper::SaveStringToFile(OutputOption.TelemetryReport, *TelemetryReportPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+        {
+            UE_LOG(LogCommandletPlugin, Display, TEXT("Telemetry report has been written to %s"), *TelemetryReportPath);
+        }
+        else
+        {
+            UE_LOG(LogCommandletPlugin, Warning, TEXT("Telemetry report could not be written to %s"), *TelemetryReportPath);
+        }
+    }
+
     if (HttpRequests_FatalError_State.GetValue() > 0)
     {
         bResult = false;
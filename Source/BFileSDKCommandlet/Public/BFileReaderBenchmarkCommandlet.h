@@ -0,0 +1,47 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "BFileHeader.h"
+#include "BFileReaderBenchmarkCommandlet.generated.h"
+
+/*
+* Usage: -run=BFileReaderBenchmark
+*	Existing stream:	-Input=<uncompressed x3 stream> -FileType=hierarchy|geometry|metadata
+*	Synthetic streams:	[-FileType=hierarchy,geometry,metadata] [-Nodes=10000] [-Vertices=1000] [-LODs=1] [-Parts=2] [-Children=4] [-MetadataBytes=256] [-Seed=0]
+*	Common:				[-Compression=none,deflate,lz4,zstd] [-ChunkSizes=8192,65536,1048576] [-Threads=1,<all>] [-Iterations=3]
+* Reports ratio and codec throughput per compression; MB/s (uncompressed) and nodes/s of BFileReader::ReadFromStream per chunk size and thread count.
+* Chunk sizes only apply to uncompressed streams; compressed streams are read in the codec's own chunk size.
+*/
+UCLASS()
+class UBFileReaderBenchmarkCommandlet
+	: public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	/** Default constructor. */
+	UBFileReaderBenchmarkCommandlet();
+
+	//~ UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	bool ParseFileTypes(const FString& Names, TArray<EBNodeType>& OutFileTypes) const;
+	bool ParseCompressions(const FString& Names);
+	bool ParseIntegers(const FString& Values, TArray<int32>& OutValues) const;
+
+	void BenchmarkStream(EBNodeType FileType, const TArray<uint8>& UncompressedStream);
+	void BenchmarkCodec(EBFileCompressionCodec Codec, EBNodeType FileType, const TArray<uint8>& UncompressedStream);
+	void BenchmarkRead(const TCHAR* CompressionName, EBNodeType FileType, const TArray<uint8>& Stream, EBFileCompressionState CompressionState, int64 UncompressedSize, int32 ChunkSize);
+
+	//Returns number of nodes read
+	int64 ReadStream(EBNodeType FileType, const TArray<uint8>& Stream, EBFileCompressionState CompressionState, int32 ChunkSize, int32 ThreadCount);
+
+	bool bBenchmarkUncompressed = false;
+	TArray<EBFileCompressionCodec> Codecs;
+	TArray<int32> ChunkSizes;
+	TArray<int32> ThreadCounts;
+	int32 Iterations = 3;
+};
\ No newline at end of file
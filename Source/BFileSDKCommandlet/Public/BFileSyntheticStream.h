@@ -0,0 +1,41 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BFileCommonTypes.h"
+
+struct FBSyntheticStreamOptions
+{
+	int32 NodeCount = 10000;
+
+	//Hierarchy
+	int32 ChildCount = 4; //Children per node; nodes form a complete tree
+	int32 PartCount = 2; //Geometry parts per hierarchy node
+
+	//Geometry
+	int32 LODCount = 1;
+	int32 VertexCount = 1000; //Per LOD; index count is the same
+	bool bQuantizedGeometry = false; //Writes EBFileHeaderFlags_QuantizedGeometry layout
+	bool bEncodedIndexes = false; //Writes EBFileHeaderFlags_EncodedIndexes layout
+
+	//Metadata
+	int32 MetadataBytes = 256; //Approximate JSON size per node
+
+	int32 Seed = 0;
+};
+
+/*
+* Generates uncompressed x3 streams (header included) in the exact layout that node FromBytes functions read.
+* Hierarchy, geometry and metadata streams generated with the same options reference each other by ID.
+*/
+class BFileSyntheticStream
+{
+public:
+	static void Generate(EBNodeType InFileType, const FBSyntheticStreamOptions& InOptions, TArray<uint8>& OutStream);
+
+private:
+	static void GenerateHierarchyNode(uint64 InNodeID, const FBSyntheticStreamOptions& InOptions, FRandomStream& Random, TArray<uint8>& OutStream);
+	static void GenerateGeometryNode(uint64 InNodeID, const FBSyntheticStreamOptions& InOptions, FRandomStream& Random, TArray<uint8>& OutStream);
+	static void GenerateMetadataNode(uint64 InNodeID, const FBSyntheticStreamOptions& InOptions, FRandomStream& Random, TArray<uint8>& OutStream);
+};
\ No newline at end of file
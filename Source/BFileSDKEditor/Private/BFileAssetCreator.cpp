@@ -5,150 +5,433 @@
 #include "BFileAsset.h"
 #include "BFileFinalTypes.h"
 #include "BFileMeshSerialization.h"
+#include "BFileTangentBasis.h"
 #include "BLambdaRunnable.h"
 #include "Engine/StaticMesh.h"
 #include "Runtime/RawMesh/Public/RawMesh.h"
 #include "PhysicsEngine/BodySetup.h"
+#include "Hash/CityHash.h"
 
 BFileAssetCreator::BFileAssetCreator(BFinalAssetContent* InAssetPtr, TFunction<void(TFunction<void()>)> InTaskQueuer)
 {
 	AssetPtr = InAssetPtr;
 	TaskQueuer = InTaskQueuer;
+
+	QueuedBytes = 0;
+	PeakQueuedBytes = 0;
+
+	//Manual-reset; readers of all file types may be waiting at the same time.
+	QueuedBytesReleasedEvent = FGenericPlatformProcess::GetSynchEventFromPool(true);
 }
 
-void BFileAssetCreator::ProvideNewNode(const BHierarchyNode& InNode)
+BFileAssetCreator::~BFileAssetCreator()
 {
-	ActiveTaskCount.Increment();
-	FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([this, InNode]()
-		{
-			NewHierarchyNode(InNode);
-			ActiveTaskCount.Decrement();
-		});
+	FGenericPlatformProcess::ReturnSynchEventToPool(QueuedBytesReleasedEvent);
 }
-void BFileAssetCreator::ProvideNewNode(const BGeometryNode& InNode)
+
+void BFileAssetCreator::BeginTask()
 {
-	ActiveTaskCount.Increment();
-	FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([this, InNode]()
-		{
-			NewGeometryNode(InNode);
-			ActiveTaskCount.Decrement();
-		});
+	const int32 ActiveTasks = ActiveTaskCount.Increment();
+	if (Telemetry)
+	{
+		Telemetry->Sample(EBImportGauge_ActiveTasks, ActiveTasks);
+	}
 }
-void BFileAssetCreator::ProvideNewNode(const BMetadataNode& InNode)
+
+void BFileAssetCreator::CompleteTask()
 {
-	ActiveTaskCount.Increment();
-	FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([this, InNode]()
-		{
-			NewMetadataNode(InNode);
-			ActiveTaskCount.Decrement();
-		});
+	//The creator may be destroyed as soon as the count reaches zero; nothing of this is touched after the decrement.
+	TFunction<void()> OnIdleCopy = OnIdle;
+	if (ActiveTaskCount.Decrement() == 0 && OnIdleCopy)
+	{
+		OnIdleCopy();
+	}
 }
 
-TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> BFileAssetCreator::GetOrInsertHierarchyNode(uint64 InNodeID)
+void BFileAssetCreator::SetQueuedBytesBudget(int64 InBudget)
 {
-	FScopeLock Lock(&HierarchyIDToNodeMap_Mutex);
-	TSharedPtr<BFinalHiearchyNode, ESPMode::ThreadSafe>* Found = AssetPtr->HierarchyIDToNodeMap.Find(InNodeID);
-	if (Found != nullptr) return *Found;
+	QueuedBytesBudget = FMath::Max<int64>(1, InBudget);
+}
 
-	TSharedPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> NewNode = MakeShareable(new BFinalHiearchyNode);
-	NewNode->UniqueID = InNodeID;
+void BFileAssetCreator::ReserveNodes(EBNodeType InNodeType, int64 InNodeCount)
+{
+	if (InNodeCount <= 0 || InNodeCount > MAX_int32) return;
+	const int32 Count = (int32)InNodeCount;
 
-	HierarchyID_ChildrenMutex_Map.Add(InNodeID, MakeShareable(new FCriticalSection));
+	if (InNodeType == EBNodeType::EBNodeType_Hierarchy)
+	{
+		HierarchyNodes.Reserve(Count);
+	}
+	else if (InNodeType == EBNodeType::EBNodeType_Geometry)
+	{
+		GeometryNodes.Reserve(Count);
+	}
+	else if (InNodeType == EBNodeType::EBNodeType_Metadata)
+	{
+		MetadataNodes.Reserve(Count);
+	}
+}
 
-	AssetPtr->HierarchyIDToNodeMap.Add(InNodeID, NewNode);
+void BFileAssetCreator::AcquireQueuedBytes(int64 InSize)
+{
+	while (true)
+	{
+		int64 Current = QueuedBytes.Load();
+		if (Current == 0 || Current + InSize <= QueuedBytesBudget)
+		{
+			if (QueuedBytes.CompareExchange(Current, Current + InSize))
+			{
+				int64 Peak = PeakQueuedBytes.Load();
+				while (Current + InSize > Peak && !PeakQueuedBytes.CompareExchange(Peak, Current + InSize)) {}
+
+				if (Telemetry)
+				{
+					Telemetry->Sample(EBImportGauge_QueuedNodeBytes, Current + InSize);
+				}
+				return;
+			}
+			continue;
+		}
+
+		//Reset before the second check; a release in between leaves the event signaled.
+		QueuedBytesReleasedEvent->Reset();
+		Current = QueuedBytes.Load();
+		if (Current == 0 || Current + InSize <= QueuedBytesBudget) continue;
 
-	return NewNode;
+		QueuedBytesReleasedEvent->Wait();
+	}
 }
-TWeakPtr<BFinalGeometryNode, ESPMode::ThreadSafe> BFileAssetCreator::GetOrInsertGeometryNode(uint64 InNodeID)
+
+void BFileAssetCreator::ReleaseQueuedBytes(int64 InSize)
 {
-	FScopeLock Lock(&GeometryIDToNodeMap_Mutex);
-	TSharedPtr<BFinalGeometryNode, ESPMode::ThreadSafe>* Found = AssetPtr->GeometryIDToNodeMap.Find(InNodeID);
-	if (Found != nullptr) return *Found;
+	QueuedBytes -= InSize;
+	QueuedBytesReleasedEvent->Trigger();
+}
 
-	TSharedPtr<BFinalGeometryNode, ESPMode::ThreadSafe> NewNode = MakeShareable(new BFinalGeometryNode);
-	NewNode->UniqueID = InNodeID;
+void BFileAssetCreator::ProvideNewNode(TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe> InNode)
+{
+	AddToNodeBatch(MoveTemp(InNode), PendingHierarchyNodes, PendingHierarchyNodes_Mutex, &BFileAssetCreator::NewHierarchyNode, EBImportTimer_HierarchyNodes);
+}
+void BFileAssetCreator::ProvideNewNode(TSharedPtr<BGeometryNode, ESPMode::ThreadSafe> InNode)
+{
+	int64 NodeSize = InNode->GetAllocatedSize();
+	AcquireQueuedBytes(NodeSize);
 
-	AssetPtr->GeometryIDToNodeMap.Add(InNodeID, NewNode);
+	BeginTask();
+	FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([this, Node = MoveTemp(InNode), NodeSize]() mutable
+		{
+			NewGeometryNode(*Node);
 
-	return NewNode;
+			//Returns the node's storage to the reader's pool before the budget is released.
+			Node.Reset();
+			ReleaseQueuedBytes(NodeSize);
+			CompleteTask();
+		});
 }
-TWeakPtr<BFinalMetadataNode, ESPMode::ThreadSafe> BFileAssetCreator::GetOrInsertMetadataNode(uint64 InNodeID)
+void BFileAssetCreator::ProvideNewNode(TSharedPtr<BMetadataNode, ESPMode::ThreadSafe> InNode)
 {
-	FScopeLock Lock(&MetadataIDToNodeMap_Mutex);
-	TSharedPtr<BFinalMetadataNode, ESPMode::ThreadSafe>* Found = AssetPtr->MetadataIDToNodeMap.Find(InNodeID);
-	if (Found != nullptr) return *Found;
+	AddToNodeBatch(MoveTemp(InNode), PendingMetadataNodes, PendingMetadataNodes_Mutex, &BFileAssetCreator::NewMetadataNode, EBImportTimer_MetadataNodes);
+}
 
-	TSharedPtr<BFinalMetadataNode, ESPMode::ThreadSafe> NewNode = MakeShareable(new BFinalMetadataNode);
-	NewNode->UniqueID = InNodeID;
+void BFileAssetCreator::FlushNodeBatches(EBNodeType InNodeType)
+{
+	if (InNodeType == EBNodeType::EBNodeType_Hierarchy)
+	{
+		FlushNodeBatch(PendingHierarchyNodes, PendingHierarchyNodes_Mutex, &BFileAssetCreator::NewHierarchyNode, EBImportTimer_HierarchyNodes);
+	}
+	else if (InNodeType == EBNodeType::EBNodeType_Metadata)
+	{
+		FlushNodeBatch(PendingMetadataNodes, PendingMetadataNodes_Mutex, &BFileAssetCreator::NewMetadataNode, EBImportTimer_MetadataNodes);
+	}
+}
 
-	AssetPtr->MetadataIDToNodeMap.Add(InNodeID, NewNode);
+template<typename NodeType>
+void BFileAssetCreator::AddToNodeBatch(TSharedPtr<NodeType, ESPMode::ThreadSafe>&& InNode, TBNodeBatch<NodeType>& Pending, FCriticalSection& Mutex, void (BFileAssetCreator::*Process)(const NodeType&), EBImportTimer ProcessTimer)
+{
+	TBNodeBatch<NodeType> Batch;
+	{
+		FScopeLock Lock(&Mutex);
+		Pending.Bytes += InNode->GetAllocatedSize();
+		Pending.Nodes.Add(MoveTemp(InNode));
+		if (Pending.Nodes.Num() < NodeBatchSize && Pending.Bytes < ASSET_CREATOR_NODE_BATCH_MAX_BYTES) return;
 
-	return NewNode;
+		Batch = MoveTemp(Pending);
+		Pending.Bytes = 0;
+	}
+	SubmitNodeBatch(MoveTemp(Batch), Process, ProcessTimer);
 }
 
-void BFileAssetCreator::NewHierarchyNode(const BHierarchyNode& InNewNode)
+template<typename NodeType>
+void BFileAssetCreator::FlushNodeBatch(TBNodeBatch<NodeType>& Pending, FCriticalSection& Mutex, void (BFileAssetCreator::*Process)(const NodeType&), EBImportTimer ProcessTimer)
 {
-	uint64 HNodeID = InNewNode.UniqueID;
+	TBNodeBatch<NodeType> Batch;
+	{
+		FScopeLock Lock(&Mutex);
+		if (Pending.Nodes.Num() == 0) return;
 
-	TSharedPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> HNode = GetOrInsertHierarchyNode(HNodeID).Pin();
+		Batch = MoveTemp(Pending);
+		Pending.Bytes = 0;
+	}
+	SubmitNodeBatch(MoveTemp(Batch), Process, ProcessTimer);
+}
 
-	//There is no need to use ChildNodes; we are parsing upwards in the tree.
+template<typename NodeType>
+void BFileAssetCreator::SubmitNodeBatch(TBNodeBatch<NodeType>&& InBatch, void (BFileAssetCreator::*Process)(const NodeType&), EBImportTimer ProcessTimer)
+{
+	//Pending batches are small and bounded; the budget is charged once a batch is handed to a task.
+	const int64 BatchBytes = InBatch.Bytes;
+	AcquireQueuedBytes(BatchBytes);
 
-	//Parent h-node; assign self as a child
-	if (InNewNode.ParentID == UNDEFINED_ID)
+	BeginTask();
+	if (Telemetry)
 	{
-		AssetPtr->RootNode = HNode;
+		Telemetry->Add(EBImportCounter_NodeBatches, 1);
 	}
-	else
-	{
-		uint64 ParentHNodeID = InNewNode.ParentID;
 
-		TSharedPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> ParentHNode = GetOrInsertHierarchyNode(ParentHNodeID).Pin();
-		HNode->Parent = ParentHNode;
+	FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([this, Batch = MoveTemp(InBatch), Process, ProcessTimer, BatchBytes]() mutable
+		{
+			{
+				BFileImportTelemetry::FBScope ProcessScope(Telemetry, ProcessTimer);
 
-		FScopeLock Lock(HierarchyID_ChildrenMutex_Map[ParentHNodeID].Get());
-		ParentHNode->Children.Add(HNode);
-	}
+				for (auto& Node : Batch.Nodes)
+				{
+					(this->*Process)(*Node);
 
-	uint64 MetadataNodeID = InNewNode.MetadataID;
+					//Returns the node's storage to the reader's pool as soon as it is processed.
+					Node.Reset();
+				}
+			}
+			ReleaseQueuedBytes(BatchBytes);
+			CompleteTask();
+		});
+}
 
-	HNode->Metadata = GetOrInsertMetadataNode(MetadataNodeID);
+void BFileAssetCreator::NewHierarchyNode(const BHierarchyNode& InNewNode)
+{
+	TSharedPtr<FBHierarchyRecord, ESPMode::ThreadSafe> HNode = HierarchyNodes.FindOrAdd(InNewNode.UniqueID);
+
+	//There is no need to use ChildNodes; we are parsing upwards in the tree. Children are linked in Finalize.
+	HNode->ParentID = InNewNode.ParentID;
+	HNode->MetadataID = InNewNode.MetadataID;
 
-	for (int32 i = 0; i < InNewNode.GeometryParts.Num(); i++)
+	const int32 PartCount = InNewNode.GeometryParts.Num();
+	HNode->PartGeometryIDs.Reserve(PartCount);
+	HNode->PartTransforms.Reserve(PartCount);
+	HNode->PartColors.Reserve(PartCount);
+
+	for (int32 i = 0; i < PartCount; i++)
 	{
 		auto& RefGPart = InNewNode.GeometryParts[i];
-		uint64 GeometryNodeID = RefGPart.GeometryID;
-
-		TSharedPtr<BFinalGeometryNode, ESPMode::ThreadSafe> GNode = GetOrInsertGeometryNode(GeometryNodeID).Pin();
-		TSharedPtr<BFinalGeometryPart> UGPart = MakeShareable(new BFinalGeometryPart);
 
-		UGPart->GeometryNode = GNode;
+		HNode->PartGeometryIDs.Add(RefGPart.GeometryID);
 
-		UGPart->Transform = FTransform(
+		HNode->PartTransforms.Add(FTransform(
 			FRotator(RefGPart.Rotation.X, RefGPart.Rotation.Y, RefGPart.Rotation.Z),
 			FVector(RefGPart.Location.X, RefGPart.Location.Y, RefGPart.Location.Z),
-			FVector(RefGPart.Scale.X, RefGPart.Scale.Y, RefGPart.Scale.Z));
+			FVector(RefGPart.Scale.X, RefGPart.Scale.Y, RefGPart.Scale.Z)));
 
-		UGPart->Color = FColor(RefGPart.Color.R, RefGPart.Color.G, RefGPart.Color.B);
+		HNode->PartColors.Add(FColor(RefGPart.Color.R, RefGPart.Color.G, RefGPart.Color.B));
+	}
+}
+
+void BFileAssetCreator::NewMetadataNode(const BMetadataNode& InNewNode)
+{
+	MetadataNodes.FindOrAdd(InNewNode.UniqueID)->Metadata = InNewNode.Metadata;
+}
 
-		HNode->Geometries.Add(UGPart);
+uint64 BFileAssetCreator::HashGeometryNode(const BGeometryNode& InNode, uint64 InSeed)
+{
+	//Counts are hashed along with the data, so arrays of different sizes with the same bytes do not collide.
+	uint64 Hash = CityHash64WithSeeds(nullptr, 0, (uint64)InNode.LODs.Num(), InSeed);
+	for (const BGeometryNode::BLOD& LOD : InNode.LODs)
+	{
+		Hash = CityHash64WithSeed((const char*)&Hash, sizeof(Hash), ((uint64)LOD.GetVertexCount() << 32) | (uint32)LOD.Indexes.Num());
+		if (LOD.bPackedVertices)
+		{
+			Hash = CityHash64WithSeed((const char*)LOD.Positions.GetData(), LOD.Positions.Num() * sizeof(FVector), Hash);
+			Hash = CityHash64WithSeed((const char*)LOD.TangentX.GetData(), LOD.TangentX.Num() * sizeof(FPackedNormal), Hash);
+			Hash = CityHash64WithSeed((const char*)LOD.TangentZ.GetData(), LOD.TangentZ.Num() * sizeof(FPackedNormal), Hash);
+		}
+		else
+		{
+			Hash = CityHash64WithSeed((const char*)LOD.VertexNormalTangentList.GetData(), LOD.VertexNormalTangentList.Num() * sizeof(BGeometryNode::BLOD::BVertexNormalTangent), Hash);
+		}
+		Hash = CityHash64WithSeed((const char*)LOD.Indexes.GetData(), LOD.Indexes.Num() * sizeof(uint32), Hash);
 	}
+	return Hash;
+}
 
+BFileAssetCreator::FBGeometryFingerprint BFileAssetCreator::MakeGeometryFingerprint(const BGeometryNode& InNode)
+{
+	FBGeometryFingerprint Fingerprint;
+	Fingerprint.UniqueID = InNode.UniqueID;
+	Fingerprint.SecondHash = HashGeometryNode(InNode, ASSET_CREATOR_GEOMETRY_FINGERPRINT_SEED);
+	Fingerprint.LODCount = InNode.LODs.Num();
+	Fingerprint.VertexCount = 0;
+	Fingerprint.IndexCount = 0;
+	for (const BGeometryNode::BLOD& LOD : InNode.LODs)
 	{
-		FScopeLock Lock(&HierarchyIDToNodeMap_Mutex);
-		AssetPtr->HierarchyIDToNodeMap.Add(HNodeID, HNode);
+		Fingerprint.VertexCount += LOD.GetVertexCount();
+		Fingerprint.IndexCount += LOD.Indexes.Num();
 	}
+	return Fingerprint;
 }
 
-void BFileAssetCreator::NewMetadataNode(const BMetadataNode& InNewNode)
+int32 BFileAssetCreator::Finalize()
 {
-	TSharedPtr<BFinalMetadataNode, ESPMode::ThreadSafe> MNode = GetOrInsertMetadataNode(InNewNode.UniqueID).Pin();
-	MNode->Metadata = InNewNode.Metadata;
+	check(IsCompleted());
+
+	BFileImportTelemetry::FBScope FinalizeScope(Telemetry, EBImportTimer_Finalize);
+
+	TMap<int64, TSharedPtr<FBHierarchyRecord, ESPMode::ThreadSafe>> HierarchyRecords;
+	TMap<int64, TSharedPtr<FBGeometryRecord, ESPMode::ThreadSafe>> GeometryRecords;
+	TMap<int64, TSharedPtr<FBMetadataRecord, ESPMode::ThreadSafe>> MetadataRecords;
+	HierarchyNodes.MoveTo(HierarchyRecords);
+	GeometryNodes.MoveTo(GeometryRecords);
+	MetadataNodes.MoveTo(MetadataRecords);
+
+	FScopeLock Lock(&GeometryHash_Mutex);
+
+	//Geometry and metadata first; hierarchy nodes refer to them by index.
+	TMap<uint64, int32> GeometryIDToIndex;
+	GeometryIDToIndex.Reserve(GeometryRecords.Num() + DuplicateGeometryIDToCanonicalIDMap.Num());
+	AssetPtr->GeometryIDs.Reserve(GeometryRecords.Num());
+	AssetPtr->GeometrySerializedRenderData.Reserve(GeometryRecords.Num());
+	for (auto& GPair : GeometryRecords)
+	{
+		GeometryIDToIndex.Add(GPair.Key, AssetPtr->AddGeometryNode(GPair.Key, MoveTemp(GPair.Value->SerializedRenderData)));
+	}
+	for (auto& Pair : DuplicateGeometryIDToCanonicalIDMap)
+	{
+		GeometryIDToIndex.Add(Pair.Key, GeometryIDToIndex.FindChecked(Pair.Value));
+	}
+
+	TMap<uint64, int32> MetadataIDToIndex;
+	MetadataIDToIndex.Reserve(MetadataRecords.Num());
+	AssetPtr->MetadataIDs.Reserve(MetadataRecords.Num());
+	AssetPtr->Metadata.Reserve(MetadataRecords.Num());
+	for (auto& MPair : MetadataRecords)
+	{
+		MetadataIDToIndex.Add(MPair.Key, AssetPtr->AddMetadataNode(MPair.Key, MPair.Value->Metadata));
+	}
+
+	//Referenced nodes that are not in the files are kept empty, as they would be written had they been read.
+	auto GetGeometryIndex = [this, &GeometryIDToIndex](uint64 InID)
+	{
+		int32* Index = GeometryIDToIndex.Find(InID);
+		return Index ? *Index : GeometryIDToIndex.Add(InID, AssetPtr->AddGeometryNode(InID, TArray<uint8>()));
+	};
+	auto GetMetadataIndex = [this, &MetadataIDToIndex](uint64 InID)
+	{
+		int32* Index = MetadataIDToIndex.Find(InID);
+		return Index ? *Index : MetadataIDToIndex.Add(InID, AssetPtr->AddMetadataNode(InID, nullptr));
+	};
+
+	//Sorted by parent; children of a node are contiguous and ordered by ID, so the output does not depend on task timing.
+	TArray<FBHierarchyRecord*> SortedRecords;
+	SortedRecords.Reserve(HierarchyRecords.Num());
+	int32 PartCount = 0;
+	for (auto& HPair : HierarchyRecords)
+	{
+		SortedRecords.Add(HPair.Value.Get());
+		PartCount += HPair.Value->PartGeometryIDs.Num();
+	}
+	SortedRecords.Sort([](const FBHierarchyRecord& A, const FBHierarchyRecord& B)
+		{
+			return A.ParentID != B.ParentID ? A.ParentID < B.ParentID : A.UniqueID < B.UniqueID;
+		});
+
+	TMap<uint64, int32> ParentIDToFirstRecord;
+	for (int32 i = SortedRecords.Num() - 1; i >= 0; i--)
+	{
+		ParentIDToFirstRecord.Add(SortedRecords[i]->ParentID, i);
+	}
+
+	AssetPtr->ReserveHierarchyNodes(SortedRecords.Num(), PartCount);
+
+	auto AddNode = [this, &GetGeometryIndex, &GetMetadataIndex](const FBHierarchyRecord& InRecord, int32 InParent, int32 InPreviousSibling)
+	{
+		const int32 Index = AssetPtr->AddHierarchyNode(InRecord.UniqueID, InParent, InPreviousSibling, GetMetadataIndex(InRecord.MetadataID));
+		for (int32 i = 0; i < InRecord.PartGeometryIDs.Num(); i++)
+		{
+			AssetPtr->AddPart(GetGeometryIndex(InRecord.PartGeometryIDs[i]), InRecord.PartTransforms[i], InRecord.PartColors[i]);
+		}
+		return Index;
+	};
+
+	//The first parentless node is the root; nodes unreachable from it are dropped, as they were never serialized.
+	const int32* RootRecord = ParentIDToFirstRecord.Find(UNDEFINED_ID);
+	if (RootRecord != nullptr)
+	{
+		AddNode(*SortedRecords[*RootRecord], INDEX_NONE, INDEX_NONE);
+	}
+
+	//Breadth-first; the nodes added so far are the queue.
+	for (int32 Parent = 0; Parent < AssetPtr->HierarchyIDs.Num(); Parent++)
+	{
+		const uint64 ParentID = (uint64)AssetPtr->HierarchyIDs[Parent];
+		const int32* FirstRecord = ParentIDToFirstRecord.Find(ParentID);
+		if (FirstRecord == nullptr) continue;
+
+		int32 PreviousSibling = INDEX_NONE;
+		for (int32 Record = *FirstRecord; Record < SortedRecords.Num() && SortedRecords[Record]->ParentID == ParentID; Record++)
+		{
+			PreviousSibling = AddNode(*SortedRecords[Record], Parent, PreviousSibling);
+		}
+	}
+
+	int32 RemovedCount = DuplicateGeometryIDToCanonicalIDMap.Num();
+	if (Telemetry)
+	{
+		Telemetry->Add(EBImportCounter_DeduplicatedGeometryNodes, RemovedCount);
+	}
+	DuplicateGeometryIDToCanonicalIDMap.Empty();
+	GeometryHashToCanonicalFingerprints.Empty();
+	return RemovedCount;
 }
 
 void BFileAssetCreator::NewGeometryNode(const BGeometryNode& InNewNode)
 {
+	{
+		BFileImportTelemetry::FBScope HashScope(Telemetry, EBImportTimer_GeometryHash);
+		const uint64 Hash = HashGeometryNode(InNewNode, 0);
+		const FBGeometryFingerprint Fingerprint = MakeGeometryFingerprint(InNewNode);
+
+		FScopeLock Lock(&GeometryHash_Mutex);
+		TArray<FBGeometryFingerprint>& Bucket = GeometryHashToCanonicalFingerprints.FindOrAdd(Hash);
+		for (const FBGeometryFingerprint& Canonical : Bucket)
+		{
+			//The same node read twice is already being built.
+			if (Canonical.UniqueID == InNewNode.UniqueID) return;
+
+			if (Canonical.Matches(Fingerprint))
+			{
+				DuplicateGeometryIDToCanonicalIDMap.Add(InNewNode.UniqueID, Canonical.UniqueID);
+				return;
+			}
+		}
+		Bucket.Add(Fingerprint);
+	}
+
+	if (bBuildRenderDataDirectly)
+	{
+		TSharedPtr<FBGeometryRecord, ESPMode::ThreadSafe> GNode = GeometryNodes.FindOrAdd(InNewNode.UniqueID);
+		{
+			BFileImportTelemetry::FBScope SerializationScope(Telemetry, EBImportTimer_RenderDataSerialization);
+			BFileMeshSerialization::SerializeGeometryNode(InNewNode, GNode->SerializedRenderData);
+		}
+		if (Telemetry)
+		{
+			Telemetry->Add(EBImportCounter_RenderDataBytes, GNode->SerializedRenderData.Num());
+		}
+		return;
+	}
+
+	//Engine build path
+	BFileImportTelemetry::FBScope ExpansionScope(Telemetry, EBImportTimer_RawMeshExpansion);
+
 	UStaticMesh* StaticMesh = NewObject<UStaticMesh>();
+	StaticMesh->AddToRoot(); //Waits for its batch unreferenced
 	StaticMesh->LightingGuid = FGuid::NewGuid();
 	StaticMesh->bAllowCPUAccess = true;
 	StaticMesh->InitResources();
@@ -167,61 +450,51 @@ void BFileAssetCreator::NewGeometryNode(const BGeometryNode& InNewNode)
 			FRawMesh RawMesh;
 
 			//Copy vertex data
-			int32 VertexCount = LODInfo.VertexNormalTangentList.Num();
-			RawMesh.VertexPositions.SetNumUninitialized(VertexCount);
-
-			for (int32 j = 0; j < VertexCount; j++)
+			int32 VertexCount = LODInfo.GetVertexCount();
+			if (LODInfo.bPackedVertices)
 			{
-				auto& Vertex = LODInfo.VertexNormalTangentList[j].Vertex;
-				RawMesh.VertexPositions[j] = FVector(Vertex.X, Vertex.Y, Vertex.Z);
+				RawMesh.VertexPositions = LODInfo.Positions;
+			}
+			else
+			{
+				RawMesh.VertexPositions.SetNumUninitialized(VertexCount);
+
+				for (int32 j = 0; j < VertexCount; j++)
+				{
+					auto& Vertex = LODInfo.VertexNormalTangentList[j].Vertex;
+					RawMesh.VertexPositions[j] = FVector(Vertex.X, Vertex.Y, Vertex.Z);
+				}
 			}
 
 			//Copy index data
 			int32 IndexCount = LODInfo.Indexes.Num();
 			check(IndexCount % 3 == 0);
 
-			RawMesh.WedgeIndices.SetNumUninitialized(IndexCount);
+			//Basis is computed once per vertex; wedges only reference it by index.
+			TArray<FVector> TangentX, TangentY, TangentZ;
+			BFileTangentBasis::Compute(LODInfo, TangentX, TangentY, TangentZ);
+
+			RawMesh.WedgeIndices = LODInfo.Indexes;
 			RawMesh.WedgeTangentX.SetNumUninitialized(IndexCount);
 			RawMesh.WedgeTangentY.SetNumUninitialized(IndexCount);
 			RawMesh.WedgeTangentZ.SetNumUninitialized(IndexCount);
-			RawMesh.WedgeColors.SetNumUninitialized(IndexCount);
+			RawMesh.WedgeColors.Init(DefaultVertexColor, IndexCount);
 			RawMesh.WedgeTexCoords[0].SetNumZeroed(IndexCount);
 
+			//Indexes are range checked when the node is decoded
 			for (int32 j = 0; j < IndexCount; j++)
 			{
-				uint32 Indice = LODInfo.Indexes[j];
-
-				check(Indice >= 0 || Indice < (uint32)VertexCount);
-
-				RawMesh.WedgeIndices[j] = Indice;
-
-				auto& VNT = LODInfo.VertexNormalTangentList[Indice];
-
-				auto& XNormal = VNT.Normal;
-				FVector Normal(XNormal.X, XNormal.Y, XNormal.Z);
-				Normal.Normalize();
-
-				auto& XTangent = VNT.Tangent;
-				FVector Tangent(XTangent.X, XTangent.Y, XTangent.Z);
-				Tangent.Normalize();
-
-				FVector Bitangent = FVector::CrossProduct(Normal, Tangent);
-				Bitangent.Normalize();
+				const uint32 Indice = LODInfo.Indexes[j];
 
 				//https://gamedev.stackexchange.com/a/51402
-				RawMesh.WedgeTangentX[j] = Tangent;
-				RawMesh.WedgeTangentY[j] = Bitangent;
-				RawMesh.WedgeTangentZ[j] = Normal;
-
-				RawMesh.WedgeColors[j] = DefaultVertexColor;
+				RawMesh.WedgeTangentX[j] = TangentX[Indice];
+				RawMesh.WedgeTangentY[j] = TangentY[Indice];
+				RawMesh.WedgeTangentZ[j] = TangentZ[Indice];
 			}
 
 			//Copy face data
-			for (int32 j = 0; j < IndexCount / 3; j++)
-			{
-				RawMesh.FaceMaterialIndices.Add(0);
-				RawMesh.FaceSmoothingMasks.Add(0xFFFFFFFF);
-			}
+			RawMesh.FaceMaterialIndices.Init(0, IndexCount / 3);
+			RawMesh.FaceSmoothingMasks.Init(0xFFFFFFFF, IndexCount / 3);
 
 			SourceModel->BuildSettings.bBuildAdjacencyBuffer = false;
 			SourceModel->BuildSettings.bBuildReversedIndexBuffer = false;
@@ -253,26 +526,77 @@ void BFileAssetCreator::NewGeometryNode(const BGeometryNode& InNewNode)
 	StaticMesh->CreateBodySetup();
 	StaticMesh->BodySetup->CollisionTraceFlag = CTF_UseComplexAsSimple;
 
-	FEvent* GameThreadCompletedEvent = FGenericPlatformProcess::GetSynchEventFromPool();
+	//Serialized once its batch is built; ActiveTaskCount covers the mesh until then.
+	BeginTask();
 
-	auto GameThreadTask = [StaticMesh, GameThreadCompletedEvent]()
+	TArray<FBPendingStaticMeshBuild> Batch;
 	{
-		BuildStaticMesh(StaticMesh, GameThreadCompletedEvent); //TODO: BatchBuild!
-	};
-	TaskQueuer(GameThreadTask);
+		FScopeLock Lock(&PendingStaticMeshBuilds_Mutex);
+		PendingStaticMeshBuilds.Add({ StaticMesh, GeometryNodes.FindOrAdd(InNewNode.UniqueID) });
+		if (Telemetry)
+		{
+			Telemetry->Sample(EBImportGauge_PendingStaticMeshBuilds, PendingStaticMeshBuilds.Num());
+		}
+		if (PendingStaticMeshBuilds.Num() < StaticMeshBuildBatchSize) return;
 
-	GameThreadCompletedEvent->Wait();
-	FGenericPlatformProcess::ReturnSynchEventToPool(GameThreadCompletedEvent);
+		Batch = MoveTemp(PendingStaticMeshBuilds);
+	}
+	SubmitStaticMeshBuilds(MoveTemp(Batch));
+}
 
-	TSharedPtr<BFinalGeometryNode, ESPMode::ThreadSafe> GNode = GetOrInsertGeometryNode(InNewNode.UniqueID).Pin();
+void BFileAssetCreator::FlushStaticMeshBuilds()
+{
+	TArray<FBPendingStaticMeshBuild> Batch;
+	{
+		FScopeLock Lock(&PendingStaticMeshBuilds_Mutex);
+		if (PendingStaticMeshBuilds.Num() == 0) return;
 
-	//Serialize static mesh render data
-	BFileMeshSerialization::SerializeStaticMesh(StaticMesh, GNode->SerializedRenderData);
+		Batch = MoveTemp(PendingStaticMeshBuilds);
+	}
+	SubmitStaticMeshBuilds(MoveTemp(Batch));
 }
 
-void BFileAssetCreator::BuildStaticMesh(UStaticMesh* StaticMesh, FEvent* DoneEvent)
+void BFileAssetCreator::SubmitStaticMeshBuilds(TArray<FBPendingStaticMeshBuild>&& InBatch)
 {
-	StaticMesh->Build(true);
+	//One game thread round trip per batch; no worker waits for it.
+	TaskQueuer([this, Batch = MoveTemp(InBatch)]()
+		{
+			TArray<UStaticMesh*> StaticMeshes;
+			StaticMeshes.Reserve(Batch.Num());
+			for (const FBPendingStaticMeshBuild& Pending : Batch)
+			{
+				StaticMeshes.Add(Pending.StaticMesh);
+			}
+
+			{
+				BFileImportTelemetry::FBScope BuildScope(Telemetry, EBImportTimer_StaticMeshBuild);
+				UStaticMesh::BatchBuild(StaticMeshes, true);
+			}
+			if (Telemetry)
+			{
+				Telemetry->Add(EBImportCounter_StaticMeshBuildBatches, 1);
+			}
 
-	DoneEvent->Trigger();
+			for (const FBPendingStaticMeshBuild& Pending : Batch)
+			{
+				FBLambdaRunnable::RunLambdaOnBackgroundThreadPool([this, Pending]()
+					{
+						//Serialize static mesh render data
+						{
+							BFileImportTelemetry::FBScope SerializationScope(Telemetry, EBImportTimer_RenderDataSerialization);
+							BFileMeshSerialization::SerializeStaticMesh(Pending.StaticMesh, Pending.GeometryNode->SerializedRenderData);
+						}
+						if (Telemetry)
+						{
+							Telemetry->Add(EBImportCounter_RenderDataBytes, Pending.GeometryNode->SerializedRenderData.Num());
+						}
+
+						FBLambdaRunnable::RunLambdaOnGameThread([StaticMesh = Pending.StaticMesh]()
+							{
+								StaticMesh->RemoveFromRoot();
+							});
+						CompleteTask();
+					});
+			}
+		});
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include "BFileMeshSerialization.h"
 #include "BZipFile.h"
 #include "BLambdaRunnable.h"
+#include "BFileImportTelemetry.h"
+#include "Async/Async.h"
 
 FBFileFactoryGameThreadHandlers::FBFileFactoryGameThreadHandlers(
 	TFunction<void(TFunction<void()>)> InTaskQueuer,
@@ -19,21 +21,13 @@ FBFileFactoryGameThreadHandlers::FBFileFactoryGameThreadHandlers(
 
 FBFileFactoryGameThreadHandlers::FBFileFactoryGameThreadHandlers()
 {
-	TaskQueuer = [this](TFunction<void()> ExecuteTask)
+	//Tasks go to the engine's game-thread queue; whoever queues them tracks their completion, so there is nothing to wait for here.
+	TaskQueuer = [](TFunction<void()> ExecuteTask)
 	{
-		OptionalsNotProvided_AwaitingGameThreadTasks_Num.Increment();
-		FBLambdaRunnable::RunLambdaOnGameThread([this, ExecuteTask]()
-			{
-				ExecuteTask();
-				OptionalsNotProvided_AwaitingGameThreadTasks_Num.Decrement();
-			});
+		FBLambdaRunnable::RunLambdaOnGameThread(ExecuteTask);
 	};
-	TasksDequeuerExecuter = [this]()
+	TasksDequeuerExecuter = []()
 	{
-		while (OptionalsNotProvided_AwaitingGameThreadTasks_Num.GetValue() > 0)
-		{
-			FPlatformProcess::Sleep(0.1f);
-		}
 	};
 }
 
@@ -149,10 +143,45 @@ bool FBFileAssetFactory::FactoryCreateBFileContent(
 		return false;
 	}
 
+	BFileImportTelemetry Telemetry;
+
 	BFinalAssetContent Content;
+	Content.SetTelemetry(&Telemetry);
+
+	//Auto-reset; triggered whenever there may be something to do on this thread: a queued game-thread task, a finished reader or an idle creator.
+	//Shared with every thread that triggers it; the last trigger may come after this function returns.
+	TSharedPtr<FEvent, ESPMode::ThreadSafe> ProgressEvent = MakeShareable(FGenericPlatformProcess::GetSynchEventFromPool(false), [](FEvent* Event)
+		{
+			FGenericPlatformProcess::ReturnSynchEventToPool(Event);
+		});
 
-	BFileAssetCreator AssetCreator(&Content, GameThreadTaskHandlers.TaskQueuer);
+	BFileAssetCreator AssetCreator(&Content, [&GameThreadTaskHandlers, ProgressEvent](TFunction<void()> Task)
+		{
+			GameThreadTaskHandlers.TaskQueuer(Task);
+			ProgressEvent->Trigger();
+		});
+	AssetCreator.SetIdleCallback([ProgressEvent]()
+		{
+			ProgressEvent->Trigger();
+		});
+	AssetCreator.SetTelemetry(&Telemetry);
 	BFileAssetCreator* AssetCreatorPtr = &AssetCreator;
+	if (WithOption.QueuedNodeBytesBudget > 0)
+	{
+		AssetCreator.SetQueuedBytesBudget(WithOption.QueuedNodeBytesBudget);
+	}
+	AssetCreator.SetBuildRenderDataDirectly(WithOption.bBuildRenderDataDirectly);
+	if (WithOption.NodeBatchSize > 0)
+	{
+		AssetCreator.SetNodeBatchSize(WithOption.NodeBatchSize);
+	}
+	if (WithOption.StaticMeshBuildBatchSize > 0)
+	{
+		AssetCreator.SetStaticMeshBuildBatchSize(WithOption.StaticMeshBuildBatchSize);
+	}
+
+	const int32 ReaderBufferBytes = WithOption.ReaderBufferBytes > 0 ? WithOption.ReaderBufferBytes : UNPROCESSED_DATA_RING_CAPACITY;
+	FThreadSafeCounter64 PeakReaderBufferedBytes;
 
 	FBFileFactoryInputOption* WithOptionPtr = &WithOption;
 
@@ -161,43 +190,79 @@ bool FBFileAssetFactory::FactoryCreateBFileContent(
 	Async_FactoryCreateBFileContent_ForFileType(
 		EBNodeType::EBNodeType_Hierarchy,
 		WithOption.HierarchyFileStream,
+		WithOption.HierarchyFilePath,
 		WithOption.CompressionState,
+		ReaderBufferBytes,
+		WithOption.OnReadProgress,
 		AssetCreatorPtr,
-		UncompletedTasksCount);
+		UncompletedTasksCount,
+		ProgressEvent,
+		&PeakReaderBufferedBytes,
+		&Telemetry);
 
 	Async_FactoryCreateBFileContent_ForFileType(
 		EBNodeType::EBNodeType_Geometry,
 		WithOption.GeometryFileStream,
+		WithOption.GeometryFilePath,
 		WithOption.CompressionState,
+		ReaderBufferBytes,
+		WithOption.OnReadProgress,
 		AssetCreatorPtr,
-		UncompletedTasksCount);
+		UncompletedTasksCount,
+		ProgressEvent,
+		&PeakReaderBufferedBytes,
+		&Telemetry);
 
 	Async_FactoryCreateBFileContent_ForFileType(
 		EBNodeType::EBNodeType_Metadata,
 		WithOption.MetadataFileStream,
+		WithOption.MetadataFilePath,
 		WithOption.CompressionState,
+		ReaderBufferBytes,
+		WithOption.OnReadProgress,
 		AssetCreatorPtr,
-		UncompletedTasksCount);
+		UncompletedTasksCount,
+		ProgressEvent,
+		&PeakReaderBufferedBytes,
+		&Telemetry);
 
-	while (!AssetCreator.IsCompleted() || UncompletedTasksCount->GetValue() > 0)
+	while (true)
 	{
+		//Readers must be observed done before the creator; readers only provide nodes before they are done.
+		const bool bReadersCompleted = UncompletedTasksCount->GetValue() == 0;
+
+		//No more nodes will arrive; geometry tasks still running may add meshes, so this is repeated until the creator completes.
+		if (bReadersCompleted)
+			AssetCreator.FlushStaticMeshBuilds();
+
 		GameThreadTaskHandlers.TasksDequeuerExecuter();
 
-		if (UncompletedTasksCount->GetValue() > 0)
-			FPlatformProcess::Sleep(0.1f);
+		if (bReadersCompleted && AssetCreator.IsCompleted()) break;
+
+		//A trigger between the checks above and this wait leaves the event signaled; nothing is missed.
+		ProgressEvent->Wait();
 	}
 
+	//Readers do not touch the counter after their decrement.
 	delete UncompletedTasksCount;
 
-	return FinalizeFactoryCreateBFileContent(Result, &Content);
+	//The removed count is reported through the telemetry.
+	AssetCreator.Finalize();
+
+	Result.PeakReaderBufferedBytes = PeakReaderBufferedBytes.GetValue();
+	Result.PeakQueuedNodeBytes = AssetCreator.GetPeakQueuedBytes();
+
+	bool bSucceed = FinalizeFactoryCreateBFileContent(Result, &Content);
+
+	Result.TelemetryReport = Telemetry.ToJson();
+
+	return bSucceed;
 }
 
 bool FBFileAssetFactory::FinalizeFactoryCreateBFileContent(FBFileFactoryOutputOption& Result, BFinalAssetContent* Content)
 {
-	bool* bSucceedPtr = new bool(true);
-
-	FThreadSafeCounter* UncompletedTasksCount = new FThreadSafeCounter(Result.OutputFiles.Num());
-	FEvent* CompletedEvent = FGenericPlatformProcess::GetSynchEventFromPool();
+	//One dedicated thread per output format; each future completes with its XSerialize result.
+	TArray<TFuture<bool>> SerializationResults;
 
 	for (auto& Pair : Result.OutputFiles)
 	{
@@ -205,65 +270,89 @@ bool FBFileAssetFactory::FinalizeFactoryCreateBFileContent(FBFileFactoryOutputOp
 
 		auto OutputBufferAlternative = Pair.Value;
 
-		FBLambdaRunnable::RunLambdaOnDedicatedBackgroundThread([bSucceedPtr, OutputFormat, OutputBufferAlternative, Content, UncompletedTasksCount, CompletedEvent]()
+		SerializationResults.Add(Async(EAsyncExecution::Thread, [OutputFormat, OutputBufferAlternative, Content]()
 			{
-				if (*bSucceedPtr == false)
-				{
-					if (UncompletedTasksCount->Decrement() == 0) CompletedEvent->Trigger();
-					return;
-				}
-
-				bool bSuccess = Content->XSerialize(OutputFormat, OutputBufferAlternative);
-				if (!bSuccess)
-				{
-					*bSucceedPtr = false;
-				}
-
-				if (UncompletedTasksCount->Decrement() == 0) CompletedEvent->Trigger();
-			});
+				return Content->XSerialize(OutputFormat, OutputBufferAlternative);
+			}));
 	}
 
-	CompletedEvent->Wait();
-	FGenericPlatformProcess::ReturnSynchEventToPool(CompletedEvent);
-	delete UncompletedTasksCount;
-
-	bool bSucceed = *bSucceedPtr;
-	delete bSucceedPtr;
+	bool bSucceed = true;
+	for (TFuture<bool>& SerializationResult : SerializationResults)
+	{
+		bSucceed &= SerializationResult.Get();
+	}
 	return bSucceed;
 }
 
 void FBFileAssetFactory::Async_FactoryCreateBFileContent_ForFileType(
 	EBNodeType InFileType,
 	std::istream* InStream,
+	const FString& InFilePath,
 	EBFileCompressionState InCompressionState,
+	int32 InReaderBufferBytes,
+	TFunction<void(EBNodeType, float)> OnReadProgress,
 	BFileAssetCreator* AssetCreatorPtr,
-	FThreadSafeCounter* UncompletedTasksCount)
+	FThreadSafeCounter* UncompletedTasksCount,
+	TSharedPtr<FEvent, ESPMode::ThreadSafe> ProgressEvent,
+	FThreadSafeCounter64* PeakReaderBufferedBytes,
+	BFileImportTelemetry* Telemetry)
 {
-	FBLambdaRunnable::RunLambdaOnDedicatedBackgroundThread([InFileType, InStream, InCompressionState, AssetCreatorPtr, UncompletedTasksCount]()
+	FBLambdaRunnable::RunLambdaOnDedicatedBackgroundThread([InFileType, InStream, InFilePath, InCompressionState, InReaderBufferBytes, OnReadProgress, AssetCreatorPtr, UncompletedTasksCount, ProgressEvent, PeakReaderBufferedBytes, Telemetry]()
 		{
-			BFileReader Reader(InFileType);
-			Reader.ReadFromStream(InStream, InCompressionState,
-				[](uint32 FileSDKVersion)
-				{
-				},
-				[AssetCreatorPtr](const BHierarchyNode& Node)
-				{
-					AssetCreatorPtr->ProvideNewNode(Node);
-				},
-				[AssetCreatorPtr](const BGeometryNode& Node)
+			auto OnFileSDKVersionRead = [](uint32 FileSDKVersion)
+			{
+			};
+			auto OnHierarchyNodeRead = [AssetCreatorPtr](TSharedPtr<BHierarchyNode, ESPMode::ThreadSafe> Node)
+			{
+				AssetCreatorPtr->ProvideNewNode(MoveTemp(Node));
+			};
+			auto OnGeometryNodeRead = [AssetCreatorPtr](TSharedPtr<BGeometryNode, ESPMode::ThreadSafe> Node)
+			{
+				AssetCreatorPtr->ProvideNewNode(MoveTemp(Node));
+			};
+			auto OnMetadataNodeRead = [AssetCreatorPtr](TSharedPtr<BMetadataNode, ESPMode::ThreadSafe> Node)
+			{
+				AssetCreatorPtr->ProvideNewNode(MoveTemp(Node));
+			};
+			auto OnError = [](int32 ErrorCode, const FString& ErrorMessage)
+			{
+				UE_LOG(LogTemp, Error, TEXT("BFileReader->Error: %s"), *ErrorMessage);
+			};
+
+			//Destroyed before the counter is decremented.
+			{
+				//Callbacks block in ProvideNewNode while the creator's budget is exceeded; that fills the reader's buffer, which in turn blocks the stream producer.
+				BFileReader Reader(InFileType, InReaderBufferBytes);
+				Reader.SetTelemetry(Telemetry);
+				Reader.SetHeaderReadCallback([InFileType, AssetCreatorPtr](const BFileHeader& Header)
+					{
+						AssetCreatorPtr->ReserveNodes(InFileType, Header.GetNodeCount());
+					});
+				if (OnReadProgress)
 				{
-					AssetCreatorPtr->ProvideNewNode(Node);
-				},
-				[AssetCreatorPtr](const BMetadataNode& Node)
+					Reader.SetProgressCallback([InFileType, OnReadProgress](float Progress)
+						{
+							if (Progress >= 0.0f) OnReadProgress(InFileType, Progress);
+						});
+				}
+				if (InStream != nullptr)
 				{
-					AssetCreatorPtr->ProvideNewNode(Node);
-				},
-				[](int32 ErrorCode, const FString& ErrorMessage)
+					Reader.ReadFromStream(InStream, InCompressionState, OnFileSDKVersionRead, OnHierarchyNodeRead, OnGeometryNodeRead, OnMetadataNodeRead, OnError);
+				}
+				else
 				{
-					UE_LOG(LogTemp, Error, TEXT("BFileReader->Error: %s"), *ErrorMessage);
-				});
+					Reader.ReadFromFile(InFilePath, InCompressionState, OnFileSDKVersionRead, OnHierarchyNodeRead, OnGeometryNodeRead, OnMetadataNodeRead, OnError);
+				}
 
+				//Before the counter is decremented; the factory stops waiting once all readers are done and no task is active.
+				AssetCreatorPtr->FlushNodeBatches(InFileType);
+
+				PeakReaderBufferedBytes->Add(Reader.GetPeakBufferedBytes());
+			}
+
+			//The factory may return right after the decrement; only the event, owned by this lambda too, is used after it.
 			UncompletedTasksCount->Decrement();
+			ProgressEvent->Trigger();
 		});
 }
 
@@ -335,16 +424,21 @@ void UBFileAssetFactory::FactoryCreateFile_GameThreadHandlers_Initialize(FBFileF
 	};
 	Handlers.TasksDequeuerExecuter = [this]()
 	{
-		while (AwaitingGameThreadTasks.Num() > 0)
+		//Tasks may queue further tasks; they are taken in rounds so the lock is not held while running them.
+		while (true)
 		{
-			TFunction<void()> AwaitingTask;
+			TArray<TFunction<void()>> AwaitingTasks;
 			{
 				FScopeLock Lock(&AwaitingGameThreadTasks_Mutex);
-				AwaitingTask = AwaitingGameThreadTasks[0];
+				if (AwaitingGameThreadTasks.Num() == 0) return;
+
+				AwaitingTasks = MoveTemp(AwaitingGameThreadTasks);
 			}
-			AwaitingGameThreadTasks.RemoveAt(0);
 
-			AwaitingTask();
+			for (auto& AwaitingTask : AwaitingTasks)
+			{
+				AwaitingTask();
+			}
 		}
 	};
 }
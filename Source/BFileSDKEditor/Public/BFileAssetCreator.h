@@ -5,6 +5,15 @@
 #include "CoreMinimal.h"
 #include "BFileCommonTypes.h"
 #include "BFileFinalTypes.h"
+#include "BFileShardedNodeMap.h"
+#include "BFileImportTelemetry.h"
+#include "Templates/Atomic.h"
+
+#define ASSET_CREATOR_QUEUED_BYTES_BUDGET (512 * 1024 * 1024)
+#define ASSET_CREATOR_STATIC_MESH_BUILD_BATCH_SIZE 64
+#define ASSET_CREATOR_NODE_BATCH_SIZE 1024
+#define ASSET_CREATOR_NODE_BATCH_MAX_BYTES (1024 * 1024)
+#define ASSET_CREATOR_GEOMETRY_FINGERPRINT_SEED 0x9E3779B97F4A7C15ULL
 
 class BFileAssetCreator
 {
@@ -13,33 +22,148 @@ private:
 
 	TFunction<void(TFunction<void()>)> TaskQueuer;
 
-	FCriticalSection HierarchyIDToNodeMap_Mutex;
-	FCriticalSection GeometryIDToNodeMap_Mutex;
-	FCriticalSection MetadataIDToNodeMap_Mutex;
-
-	TMap<uint64, TSharedPtr<FCriticalSection, ESPMode::ThreadSafe>> HierarchyID_ChildrenMutex_Map; //Secured by HierarchyIDToNodeMap_Mutex
+	//Build-time records; nodes only refer to each other by ID until Finalize flattens them into AssetPtr's index-based arrays.
+	struct FBHierarchyRecord
+	{
+		uint64 UniqueID;
+		uint64 ParentID = UNDEFINED_ID;
+		uint64 MetadataID = UNDEFINED_ID;
 
-	TWeakPtr<BFinalHiearchyNode, ESPMode::ThreadSafe> GetOrInsertHierarchyNode(uint64 InNodeID);
-	TWeakPtr<BFinalGeometryNode, ESPMode::ThreadSafe> GetOrInsertGeometryNode(uint64 InNodeID);
-	TWeakPtr<BFinalMetadataNode, ESPMode::ThreadSafe> GetOrInsertMetadataNode(uint64 InNodeID);
+		TArray<uint64> PartGeometryIDs;
+		TArray<FTransform> PartTransforms;
+		TArray<FColor> PartColors;
+	};
+	struct FBGeometryRecord
+	{
+		uint64 UniqueID;
+		TArray<uint8> SerializedRenderData;
+	};
+	struct FBMetadataRecord
+	{
+		uint64 UniqueID;
+		TSharedPtr<class BLazyMetadata, ESPMode::ThreadSafe> Metadata;
+	};
+	TBFileShardedNodeMap<FBHierarchyRecord> HierarchyNodes;
+	TBFileShardedNodeMap<FBGeometryRecord> GeometryNodes;
+	TBFileShardedNodeMap<FBMetadataRecord> MetadataNodes;
 
 	void NewHierarchyNode(const class BHierarchyNode& InNewNode);
 	void NewGeometryNode(const class BGeometryNode& InNewNode);
 	void NewMetadataNode(const class BMetadataNode& InNewNode);
 
-	static void BuildStaticMesh(class UStaticMesh* StaticMesh, class FEvent* DoneEvent);
+	//Meshes are built on the game thread in batches through UStaticMesh::BatchBuild; serialization continues on the pool.
+	struct FBPendingStaticMeshBuild
+	{
+		class UStaticMesh* StaticMesh;
+		TSharedPtr<FBGeometryRecord, ESPMode::ThreadSafe> GeometryNode;
+	};
+	FCriticalSection PendingStaticMeshBuilds_Mutex;
+	TArray<FBPendingStaticMeshBuild> PendingStaticMeshBuilds; //Secured by PendingStaticMeshBuilds_Mutex
+	int32 StaticMeshBuildBatchSize = ASSET_CREATOR_STATIC_MESH_BUILD_BATCH_SIZE;
+
+	bool bBuildRenderDataDirectly = true;
+
+	void SubmitStaticMeshBuilds(TArray<FBPendingStaticMeshBuild>&& InBatch);
+
+	//Byte-identical geometry nodes under different IDs are built once; parts of duplicates are remapped to the first one in Finalize.
+	//The hash finds candidates; a duplicate must also match a canonical node's fingerprint, so decoded nodes are released as soon as they are processed.
+	struct FBGeometryFingerprint
+	{
+		uint64 UniqueID;
+		uint64 SecondHash; //Seeded independently of the map key
+		int32 LODCount;
+		int64 VertexCount;
+		int64 IndexCount;
+
+		bool Matches(const FBGeometryFingerprint& Other) const
+		{
+			return SecondHash == Other.SecondHash && LODCount == Other.LODCount && VertexCount == Other.VertexCount && IndexCount == Other.IndexCount;
+		}
+	};
+	static uint64 HashGeometryNode(const class BGeometryNode& InNode, uint64 InSeed);
+	static FBGeometryFingerprint MakeGeometryFingerprint(const class BGeometryNode& InNode);
+
+	FCriticalSection GeometryHash_Mutex;
+	TMap<uint64, TArray<FBGeometryFingerprint>> GeometryHashToCanonicalFingerprints; //Secured by GeometryHash_Mutex
+	TMap<uint64, uint64> DuplicateGeometryIDToCanonicalIDMap; //Secured by GeometryHash_Mutex
+
+	//Hierarchy and metadata nodes are too small for a task each; they are processed in batches of NodeBatchSize nodes (or ASSET_CREATOR_NODE_BATCH_MAX_BYTES) per task.
+	template<typename NodeType>
+	struct TBNodeBatch
+	{
+		TArray<TSharedPtr<NodeType, ESPMode::ThreadSafe>> Nodes;
+		int64 Bytes = 0;
+	};
+	FCriticalSection PendingHierarchyNodes_Mutex;
+	TBNodeBatch<class BHierarchyNode> PendingHierarchyNodes; //Secured by PendingHierarchyNodes_Mutex
+	FCriticalSection PendingMetadataNodes_Mutex;
+	TBNodeBatch<class BMetadataNode> PendingMetadataNodes; //Secured by PendingMetadataNodes_Mutex
+	int32 NodeBatchSize = ASSET_CREATOR_NODE_BATCH_SIZE;
+
+	template<typename NodeType>
+	void AddToNodeBatch(TSharedPtr<NodeType, ESPMode::ThreadSafe>&& InNode, TBNodeBatch<NodeType>& Pending, FCriticalSection& Mutex, void (BFileAssetCreator::*Process)(const NodeType&), EBImportTimer ProcessTimer);
+	template<typename NodeType>
+	void FlushNodeBatch(TBNodeBatch<NodeType>& Pending, FCriticalSection& Mutex, void (BFileAssetCreator::*Process)(const NodeType&), EBImportTimer ProcessTimer);
+	template<typename NodeType>
+	void SubmitNodeBatch(TBNodeBatch<NodeType>&& Batch, void (BFileAssetCreator::*Process)(const NodeType&), EBImportTimer ProcessTimer);
 
 	FThreadSafeCounter ActiveTaskCount;
+	TFunction<void()> OnIdle;
+
+	BFileImportTelemetry* Telemetry = nullptr;
+
+	//Every task starts with BeginTask and ends with CompleteTask; the latter calls OnIdle when it was the last active one.
+	//CompleteTask must be the last thing a task does; the creator and its telemetry may be gone right after.
+	void BeginTask();
+	void CompleteTask();
+
+	//Nodes waiting for or being processed by tasks; ProvideNewNode blocks while the budget is exceeded.
+	void AcquireQueuedBytes(int64 InSize);
+	void ReleaseQueuedBytes(int64 InSize);
+
+	int64 QueuedBytesBudget = ASSET_CREATOR_QUEUED_BYTES_BUDGET;
+	TAtomic<int64> QueuedBytes;
+	TAtomic<int64> PeakQueuedBytes;
+	FEvent* QueuedBytesReleasedEvent;
 
 public:
 	BFileAssetCreator(class BFinalAssetContent* InAssetPtr, TFunction<void(TFunction<void()>)> InTaskQueuer);
+	~BFileAssetCreator();
+
+	//Called from the thread completing the last active task whenever the creator becomes idle; may be called more than once. Set before providing nodes.
+	//It may run after the creator is destroyed; it must only use what it owns.
+	void SetIdleCallback(TFunction<void()> InOnIdle) { OnIdle = InOnIdle; }
+
+	//Optional; must outlive the creator's tasks. Node processing, mesh build and render data stages, task and queue depths are reported.
+	void SetTelemetry(BFileImportTelemetry* InTelemetry) { Telemetry = InTelemetry; }
 
-	void ProvideNewNode(const class BHierarchyNode& InNode);
-	void ProvideNewNode(const class BGeometryNode& InNode);
-	void ProvideNewNode(const class BMetadataNode& InNode);
+	//A single node larger than the budget is still accepted when nothing else is queued.
+	void SetQueuedBytesBudget(int64 InBudget);
+
+	//When false, geometry goes through FRawMesh and UStaticMesh::BatchBuild on the game thread instead of BFileMeshSerialization::SerializeGeometryNode.
+	void SetBuildRenderDataDirectly(bool bInDirectly) { bBuildRenderDataDirectly = bInDirectly; }
+	void SetNodeBatchSize(int32 InBatchSize) { NodeBatchSize = FMath::Max(1, InBatchSize); }
+	void SetStaticMeshBuildBatchSize(int32 InBatchSize) { StaticMeshBuildBatchSize = FMath::Max(1, InBatchSize); }
+
+	//Submits hierarchy or metadata nodes waiting for a full batch; called when the reader of that type is done.
+	void FlushNodeBatches(EBNodeType InNodeType);
+
+	//Submits meshes waiting for a full batch; called once readers are done, otherwise the last partial batch is never built.
+	void FlushStaticMeshBuilds();
+
+	//Presizes the node map of given type; called when a file header tells its node count.
+	void ReserveNodes(EBNodeType InNodeType, int64 InNodeCount);
+	int64 GetPeakQueuedBytes() const { return PeakQueuedBytes.Load(); }
+
+	void ProvideNewNode(TSharedPtr<class BHierarchyNode, ESPMode::ThreadSafe> InNode);
+	void ProvideNewNode(TSharedPtr<class BGeometryNode, ESPMode::ThreadSafe> InNode);
+	void ProvideNewNode(TSharedPtr<class BMetadataNode, ESPMode::ThreadSafe> InNode);
 
 	bool IsCompleted() const
 	{
 		return ActiveTaskCount.GetValue() == 0;
 	}
+
+	//Must be called once all readers are done and IsCompleted returns true; fills the asset's arrays in breadth-first hierarchy order and collapses duplicate geometry nodes. Returns the number of geometry nodes removed.
+	int32 Finalize();
 };
\ No newline at end of file
@@ -20,9 +20,30 @@ struct BFILESDKEDITOR_API FBFileFactoryInputOption
 public:
 	EBFileCompressionState CompressionState;
 
-	std::istream* HierarchyFileStream;
-	std::istream* GeometryFileStream;
-	std::istream* MetadataFileStream;
+	std::istream* HierarchyFileStream = nullptr;
+	std::istream* GeometryFileStream = nullptr;
+	std::istream* MetadataFileStream = nullptr;
+
+	//Used when the corresponding stream is null; uncompressed files are memory-mapped.
+	FString HierarchyFilePath;
+	FString GeometryFilePath;
+	FString MetadataFilePath;
+
+	//Memory bounds; producers (inflate, download) are blocked while they are exceeded. 0 uses the defaults.
+	int32 ReaderBufferBytes = 0; //Per file type, between the stream and the parser; default UNPROCESSED_DATA_RING_CAPACITY
+	int64 QueuedNodeBytesBudget = 0; //Decoded nodes waiting for asset creation, all file types; default ASSET_CREATOR_QUEUED_BYTES_BUDGET
+
+	//Hierarchy and metadata nodes processed per task; default ASSET_CREATOR_NODE_BATCH_SIZE
+	int32 NodeBatchSize = 0;
+
+	//Static meshes per UStaticMesh::BatchBuild on the game thread when bBuildRenderDataDirectly is false; default ASSET_CREATOR_STATIC_MESH_BUILD_BATCH_SIZE
+	int32 StaticMeshBuildBatchSize = 0;
+
+	//Builds render data directly from decoded geometry on pool threads; false falls back to UStaticMesh builds on the game thread.
+	bool bBuildRenderDataDirectly = true;
+
+	//Optional; called from reader threads with 0-1 progress of a file type. Only reported for files with a v2 header.
+	TFunction<void(EBNodeType, float)> OnReadProgress;
 
 	FBFileFactoryInputOption(
 		EBFileCompressionState InCompressionState,
@@ -37,6 +58,19 @@ public:
 		MetadataFileStream = WithMetadataFileStream;
 	}
 
+	FBFileFactoryInputOption(
+		EBFileCompressionState InCompressionState,
+		const FString& WithHierarchyFilePath,
+		const FString& WithGeometryFilePath,
+		const FString& WithMetadataFilePath)
+	{
+		CompressionState = InCompressionState;
+
+		HierarchyFilePath = WithHierarchyFilePath;
+		GeometryFilePath = WithGeometryFilePath;
+		MetadataFilePath = WithMetadataFilePath;
+	}
+
 	FBFileFactoryInputOption() {}
 };
 
@@ -49,6 +83,11 @@ struct BFILESDKEDITOR_API FBFileFactoryOutputOption
 public:
 	TMap<EBFileOutputFormat, TFunction<struct FBFileOutputBufferAlternative(int64)>> OutputFiles;
 
+	//Filled after processing
+	int64 PeakReaderBufferedBytes = 0; //Sum of the peaks of all file types
+	int64 PeakQueuedNodeBytes = 0;
+	FString TelemetryReport; //JSON; per-stage timers, counters and gauges (see BFileImportTelemetry)
+
 	FBFileFactoryOutputOption(
 		const TMap<EBFileOutputFormat, TFunction<struct FBFileOutputBufferAlternative(int64)>>& InOutputFiles)
 	{
@@ -78,8 +117,6 @@ private:
 
 	//Auto handle
 	FBFileFactoryGameThreadHandlers();
-
-	FThreadSafeCounter OptionalsNotProvided_AwaitingGameThreadTasks_Num;
 };
 
 /*
@@ -107,9 +144,15 @@ private:
 	void Async_FactoryCreateBFileContent_ForFileType(
 		EBNodeType InFileType,
 		std::istream* InStream,
+		const FString& InFilePath,
 		EBFileCompressionState InCompressionState,
+		int32 InReaderBufferBytes,
+		TFunction<void(EBNodeType, float)> OnReadProgress,
 		class BFileAssetCreator* AssetCreatorPtr,
-		FThreadSafeCounter* UncompletedTasksCount);
+		FThreadSafeCounter* UncompletedTasksCount,
+		TSharedPtr<FEvent, ESPMode::ThreadSafe> ProgressEvent,
+		FThreadSafeCounter64* PeakReaderBufferedBytes,
+		class BFileImportTelemetry* Telemetry);
 
 	bool FinalizeFactoryCreateBFileContent(FBFileFactoryOutputOption& Result, class BFinalAssetContent* Content);
 };
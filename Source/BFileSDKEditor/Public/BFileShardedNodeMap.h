@@ -0,0 +1,75 @@
+/// MIT License, Copyright Burak Kara, burak@burak.io, https://en.wikipedia.org/wiki/MIT_License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#define SHARDED_NODE_MAP_SHARD_COUNT 64
+
+/*
+* ID to node map split into independently locked shards; concurrent lookups and inserts only contend when their IDs hash to the same shard.
+* Nodes are created on first lookup.
+*/
+template<typename NodeType>
+class TBFileShardedNodeMap
+{
+public:
+	TSharedPtr<NodeType, ESPMode::ThreadSafe> FindOrAdd(uint64 InNodeID)
+	{
+		FShard& Shard = Shards[GetShardIndex(InNodeID)];
+
+		FScopeLock Lock(&Shard.Mutex);
+		TSharedPtr<NodeType, ESPMode::ThreadSafe>& Node = Shard.Nodes.FindOrAdd(InNodeID);
+		if (!Node.IsValid())
+		{
+			Node = MakeShareable(new NodeType);
+			Node->UniqueID = InNodeID;
+		}
+		return Node;
+	}
+
+	void Reserve(int32 InNodeCount)
+	{
+		const int32 PerShard = InNodeCount / SHARDED_NODE_MAP_SHARD_COUNT + 1;
+		for (FShard& Shard : Shards)
+		{
+			FScopeLock Lock(&Shard.Mutex);
+			Shard.Nodes.Reserve(PerShard);
+		}
+	}
+
+	//Not thread safe; no FindOrAdd may run at the same time. Leaves the map empty.
+	void MoveTo(TMap<int64, TSharedPtr<NodeType, ESPMode::ThreadSafe>>& OutMap)
+	{
+		int32 Count = 0;
+		for (FShard& Shard : Shards) Count += Shard.Nodes.Num();
+		OutMap.Reserve(OutMap.Num() + Count);
+
+		for (FShard& Shard : Shards)
+		{
+			for (auto& Pair : Shard.Nodes)
+			{
+				OutMap.Add(Pair.Key, MoveTemp(Pair.Value));
+			}
+			Shard.Nodes.Empty();
+		}
+	}
+
+private:
+	//Cache line aligned; neighbouring shard locks would otherwise share a line.
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FShard
+	{
+		FCriticalSection Mutex;
+		TMap<uint64, TSharedPtr<NodeType, ESPMode::ThreadSafe>> Nodes;
+	};
+	FShard Shards[SHARDED_NODE_MAP_SHARD_COUNT];
+
+	static int32 GetShardIndex(uint64 InNodeID)
+	{
+		//64-bit finalizer of MurmurHash3; IDs are often sequential or share their low bits.
+		InNodeID ^= InNodeID >> 33;
+		InNodeID *= 0xff51afd7ed558ccdULL;
+		InNodeID ^= InNodeID >> 33;
+		return (int32)(InNodeID % SHARDED_NODE_MAP_SHARD_COUNT);
+	}
+};
\ No newline at end of file